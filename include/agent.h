@@ -0,0 +1,17 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <string>
+
+#include "system.h"
+
+/*
+Headless collector serving snapshots to remote viewers, see Protocol
+*/
+namespace Agent {
+// Listens on address and streams frames to every viewer, only returns
+// (by throwing std::runtime_error) if listening fails
+void Serve(System &system, std::string const &address, int n = 10);
+}; // namespace Agent
+
+#endif
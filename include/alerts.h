@@ -0,0 +1,123 @@
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string_view>
+#include <sys/types.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cgroup.h"
+#include "process.h"
+#include "snapshot.h"
+
+/*
+Alert rules evaluated on every sample, one rule per line:
+  <name> <scope>.<metric> <aggregate> <window> <op> <threshold>
+         [clear <value>] [for <duration>]
+for instance
+  ram_leak process.ram rate 60s > 100
+  cpu_hot  system.cpu min 30s > 90 clear 70
+  cpu_busy system.cpu last 0 > 80 for 10s
+Scopes and metrics:
+  system   cpu, memory (%), running, pressure (% of time stalled)
+  process  cpu (%), ram (resident MB), io (KB/s read and written, local only)
+  cgroup   cpu (%), memory (MB), read, write (KB/s)
+Aggregates over the window: last, avg, min and max, or rate, the change
+per minute. Every series keeps running sums and monotonic min/max
+deques, so an evaluation costs O(1) amortized whatever the window.
+An alert fires once the condition held for the "for" duration (debounce)
+and resolves once the value is back past the clear value (hysteresis,
+the threshold by default). Lines starting with # are comments.
+*/
+class Alerts {
+public:
+  enum Scope { kSystem_ = 0, kProcess_, kCgroup_ };
+  enum Aggregate { kLast_ = 0, kAvg_, kMin_, kMax_, kRate_ };
+
+  struct Rule {
+    std::string name;
+    std::string text;
+    Scope scope;
+    int metric;
+    Aggregate aggregate;
+    double window; // seconds
+    bool above;
+    bool inclusive;
+    double threshold;
+    double clear;
+    double hold; // seconds
+  };
+
+  // Returns the rule of one line, throws std::invalid_argument
+  static Rule Parse(std::string const &line);
+  // Returns the rules of a file, throws std::invalid_argument naming the
+  // line, or std::runtime_error if it cannot be read
+  static std::vector<Rule> Load(std::string const &path);
+
+  // Waited at most on exit for the hooks still running
+  static constexpr int kHookWaitMs{2000};
+
+  explicit Alerts(std::vector<Rule> rules);
+  ~Alerts();
+  Alerts(Alerts const &) = delete;
+  Alerts &operator=(Alerts const &) = delete;
+
+  // Appends events to path, throws std::runtime_error if it cannot
+  void SetLog(std::string const &path);
+  // Runs command with /bin/sh for every event, ALERT_RULE, ALERT_ENTITY,
+  // ALERT_VALUE and ALERT_STATE describe it
+  void SetHook(std::string const &command);
+  bool Has(Scope scope) const;
+
+  void ObserveSystem(SystemSnapshot const &system, float pressure,
+                     double now);
+  void ObserveProcesses(std::vector<Process> const &processes, double now);
+  void ObserveCgroups(std::vector<Cgroup> const &cgroups, double now);
+  // Forgets every series without resolving, for a change of source
+  void Reset();
+
+  struct Active {
+    std::string const *rule;
+    std::string entity;
+    double value;
+  };
+  std::vector<Active> const &Firing() const;
+
+private:
+  // Samples of one metric of one entity within a rule's window
+  struct Series {
+    std::deque<std::pair<double, double>> samples;
+    std::deque<std::pair<double, double>> minima;
+    std::deque<std::pair<double, double>> maxima;
+    double sum{0.0};
+    double pending_since{-1.0};
+    bool firing{false};
+    std::string label{}; // entity as it was named when firing
+    double seen{0.0};
+
+    void Add(double now, double value, double window);
+    double Value(Aggregate aggregate, double window) const;
+  };
+
+  void Observe(size_t rule, Series &series, std::string_view entity,
+               double value, double now);
+  void Emit(Rule const &rule, std::string_view entity, double value,
+            bool fired);
+
+  std::vector<Rule> rules;
+  std::vector<Series> system;
+  std::vector<std::unordered_map<int, Series>> processes;
+  std::vector<std::map<std::string, Series, std::less<>>> cgroups;
+  std::vector<Active> firing;
+  FILE *log{nullptr};
+  std::string hook;
+  std::vector<pid_t> hooks;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include <string>
+#include <string_view>
+
+/*
+A cgroup v2 group (container, service, session) of processes
+CPU, memory and I/O are read from the group's own counters instead of
+summing its processes, through descriptors kept open between refreshes
+*/
+class Cgroup {
+public:
+  explicit Cgroup(std::string_view path);
+  ~Cgroup();
+  Cgroup(Cgroup &&other) noexcept;
+  Cgroup &operator=(Cgroup &&other) noexcept;
+  Cgroup(Cgroup const &) = delete;
+  Cgroup &operator=(Cgroup const &) = delete;
+
+  std::string_view Path() const;
+  int Processes() const;
+  float getCpuUtilization() const;
+  long Memory() const;
+  float ReadRate() const;
+  float WriteRate() const;
+  bool operator<(Cgroup const &a) const;
+
+  void SetPath(std::string_view path);
+  void SetProcesses(int count);
+  void Update(double now);
+
+private:
+  void Close();
+
+  std::string_view path;
+  int processes{0};
+  // Counters from the previous update, -1 until read once
+  long usage_usec{-1};
+  long read_bytes{-1};
+  long write_bytes{-1};
+  double prev_now{0.0};
+  float cpu_utilization{0.0};
+  long memory{-1};
+  float read_rate{0.0};
+  float write_rate{0.0};
+  // cpu.stat, memory.current and io.stat
+  int cpu_fd{-1};
+  int memory_fd{-1};
+  int io_fd{-1};
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "process.h"
+#include "system.h"
+
+/*
+OpenMetrics exporter on 127.0.0.1
+Every sample is serialized once, headers included, into a reused
+buffer; a scrape only writes that buffer out, however many clients
+scrape and however often. Scrapes hold a reference to the snapshot
+rather than the lock, so a slow client never blocks Publish(). Clients
+are served one at a time, each within kRequestTimeoutMs in total.
+*/
+class Exporter {
+public:
+  // Reading the request and writing the response, per client
+  static constexpr int kRequestTimeoutMs{2000};
+
+  explicit Exporter(int port);
+  ~Exporter();
+  Exporter(Exporter const &) = delete;
+  Exporter &operator=(Exporter const &) = delete;
+
+  int Port() const;
+  void Publish(System &system, std::vector<Process> const &processes);
+
+private:
+  void Serve();
+  void Respond(int client);
+
+  int listen_fd_ = -1;
+  int port_ = 0;
+  // Written to by the destructor to wake Serve() up
+  int wake_fds_[2] = {-1, -1};
+  // Serialized into back_ without the lock, then swapped with front_;
+  // back_ is reused once no scrape still holds it
+  std::shared_ptr<std::string> front_ = {};
+  std::shared_ptr<std::string> back_ = {};
+  std::string body_ = {};
+  std::mutex mutex_ = {};
+  std::thread thread_ = {};
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <array>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "linux_parser.h"
+#include "process.h"
+
+/*
+Process filter compiled from an expression such as
+  user=postgres cpu>5 cmd~java
+Terms are space separated and all have to match. Each term is sorted
+into the stage of the scan whose data it needs, so that a process can
+be dropped by the cheap stages before the expensive reads happen:
+  pid                 before anything is read
+  comm, state, ppid   /proc/<pid>/stat
+  uid, user, ram      /proc/<pid>/status, the real uid as in the USER
+                      column and the resident MB
+  cpu, cmd, cgroup    the updated Process record
+Operators are = != < <= > >= and ~ !~ (regular expression search)
+*/
+class Filter {
+public:
+  enum Stage { kPid_ = 0, kStat_, kStatus_, kProcess_, kStageCount_ };
+
+  Filter() = default;
+  explicit Filter(std::string const &expression);
+
+  std::string const &Text() const;
+  bool Has(Stage stage) const;
+  bool Matches(int pid) const;
+  bool Matches(LinuxParser::ProcessStat const &stat) const;
+  bool Matches(LinuxParser::ProcessStatus const &status) const;
+  bool Matches(Process const &process) const;
+
+private:
+  enum Field { kPidField_, kUid_, kComm_, kState_, kPpid_, kRam_, kCpu_,
+               kCmd_, kCgroup_ };
+  enum Op { kEq_, kNe_, kLt_, kLe_, kGt_, kGe_, kMatch_, kNoMatch_ };
+  struct Term {
+    Field field;
+    Op op;
+    double number;
+    std::string text;
+    std::regex regex;
+  };
+
+  static bool Compare(Term const &term, double value);
+  static bool Compare(Term const &term, std::string_view value);
+
+  std::string text = {};
+  std::array<std::vector<Term>, kStageCount_> terms = {};
+};
+
+#endif
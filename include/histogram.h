@@ -0,0 +1,32 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+
+/*
+Fixed-size log-linear histogram of non-negative values
+Every power of two is split into 16 linear buckets, so percentiles are
+within ~6% of the true value at constant memory, whatever the count
+*/
+class Histogram {
+public:
+  void Add(long value);
+  void Merge(Histogram const &other);
+  long Percentile(double p) const;
+  long Count() const;
+  long Max() const;
+
+private:
+  static constexpr int kSubBuckets{16};
+  static constexpr int kBuckets{64 * kSubBuckets};
+
+  static int Bucket(long value);
+  static long Value(int bucket);
+
+  std::array<uint64_t, kBuckets> counts{};
+  long count{0};
+  long max{0};
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <chrono>
+#include <string>
+
+/*
+Self-instrumentation of the monitor
+Measures what each stage of a refresh costs the monitor itself
+*/
+namespace Instrumentation {
+// Stages of a refresh
+enum Stage {
+  kScan_ = 0,
+  kParse_,
+  // Memory detail and socket owners of the processes shown
+  kDetail_,
+  kSort_,
+  kRender_,
+  kStageCount_
+};
+
+// Times the enclosing scope and charges it to a stage
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Stage stage);
+  ~ScopedTimer();
+  ScopedTimer(ScopedTimer const &) = delete;
+  ScopedTimer &operator=(ScopedTimer const &) = delete;
+
+private:
+  Stage stage;
+  long syscalls;
+  long allocations;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Stage statistics
+const char *StageName(Stage stage);
+long Percentile(Stage stage, float p);
+long LastSyscalls(Stage stage);
+long LastAllocations(Stage stage);
+
+// Process-wide counters
+long Syscalls();
+long Allocations();
+
+// Cost of the monitor itself
+void SampleSelf();
+float SelfCpuUtilization();
+long SelfRss();
+
+// Writes all statistics to a file, returns false on failure
+bool Dump(const std::string &path);
+}; // namespace Instrumentation
+
+#endif
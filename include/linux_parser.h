@@ -1,9 +1,12 @@
 #ifndef SYSTEM_PARSER_H
 #define SYSTEM_PARSER_H
 
+#include <array>
 #include <fstream>
 #include <regex>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace LinuxParser {
 // Paths
@@ -15,17 +18,29 @@ const std::string kStatFilename{"/stat"};
 const std::string kUptimeFilename{"/uptime"};
 const std::string kMeminfoFilename{"/meminfo"};
 const std::string kVersionFilename{"/version"};
+const std::string kCpuPressureFilename{"/pressure/cpu"};
+const std::string kCgroupFilename{"/cgroup"};
+const std::string kIoFilename{"/io"};
+const std::string kSmapsRollupFilename{"/smaps_rollup"};
 const std::string kOSPath{"/etc/os-release"};
 const std::string kPasswordPath{"/etc/passwd"};
+const std::string kCgroupPath{"/sys/fs/cgroup"};
+
+// Raw reads into a caller buffer, no heap allocation
+int ReadFile(const char *path, char *buffer, int size);
+// A kept-open fd of kAbsentFd remembers the file did not exist
+const int kAbsentFd{-2};
+int ReadFile(int &fd, const char *path, char *buffer, int size);
 
 // System
 float MemoryUtilization();
 long UpTime();
-std::vector<int> Pids();
+void Pids(std::vector<int> &pids);
 int TotalProcesses();
 int RunningProcesses();
 std::string OperatingSystem();
 std::string Kernel();
+std::vector<std::pair<int, std::string>> Users();
 
 // CPU
 enum CPUStates {
@@ -40,15 +55,54 @@ enum CPUStates {
   kGuest_,
   kGuestNice_
 };
-std::vector<std::string> CpuUtilization();
+// Jiffies of the aggregate cpu line, user through steal
+std::array<long, kGuest_> CpuUtilization();
+float CpuPressure();
 
 // Processes
-std::string Command(int pid);
-std::string Ram(int pid);
-std::string Uid(int pid);
-std::string User(int pid);
-long int UpTime(int pid);
-std::vector<std::string> ProcessCpuUtilization(int pid);
+struct ProcessStat {
+  char comm[16];
+  char state;
+  int ppid;
+  long utime;
+  long stime;
+  long cutime;
+  long cstime;
+  int nice;
+  long starttime;
+  long startcode; // changes on exec, 1 when hidden from us
+};
+struct ProcessStatus {
+  int uid;
+  long vm_size; // kB
+  long vm_rss;  // kB
+  long vm_swap; // kB
+  long context_switches; // voluntary and involuntary
+};
+// From /proc/<pid>/smaps_rollup, in kB, all zero if unknown
+struct ProcessMemory {
+  long rss{0};
+  long pss{0}; // shared pages split between the processes mapping them
+  long swap{0};
+  long anonymous{0};
+  long file{0}; // resident but not anonymous: file, shmem
+};
+struct ProcessIo {
+  long read_bytes{0}; // from storage, page cache hits excluded
+  long write_bytes{0};
+};
+bool ReadProcessStat(int pid, ProcessStat &stat);
+bool ReadProcessStatus(int pid, ProcessStatus &status);
+// Parsers of file contents read elsewhere, see ProcReader
+bool ParseProcessStat(const char *buffer, ProcessStat &stat);
+void ParseProcessStatus(const char *buffer, ProcessStatus &status);
+void ParseProcessIo(const char *buffer, ProcessIo &io);
+bool ReadProcessMemory(int pid, ProcessMemory &memory);
+int ReadCommand(int pid, char *buffer, int size);
+int ReadCgroup(int pid, char *buffer, int size);
+
+// Control groups (v2)
+std::string const &CgroupRoot();
 }; // namespace LinuxParser
 
 #endif
\ No newline at end of file
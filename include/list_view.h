@@ -0,0 +1,37 @@
+#ifndef LIST_VIEW_H
+#define LIST_VIEW_H
+
+#include <cstddef>
+
+/*
+Scroll state of a list that is drawn one window of rows at a time
+Only rows First() to First() + Height() are ever drawn, so scrolling
+costs the same whatever the length of the list
+*/
+class ListView {
+public:
+  void Resize(int height);
+  void SetCount(size_t count);
+  void Move(long rows);
+  void Page(long pages);
+  void Home();
+  void End();
+  void Select(size_t index);
+  // Selects index at the screen row the selection had, used when the
+  // selected entry moved after a re-sort
+  void Follow(size_t index);
+  size_t First() const;
+  size_t Selected() const;
+  size_t Count() const;
+  int Height() const;
+
+private:
+  void Clamp();
+
+  size_t first{0};
+  size_t selected{0};
+  size_t count{0};
+  int height{1};
+};
+
+#endif
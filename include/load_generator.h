@@ -0,0 +1,55 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/*
+Controlled synthetic load
+Each worker is a child process (this binary re-executed with --worker)
+that repeats a period: busy for duty * period, then touches memory,
+writes and syncs a temporary file, and sleeps until the next period.
+*/
+struct WorkerSpec {
+  double duty{1.0};      // share of each period spent on the CPU
+  long period_ms{100};   // short periods mean many sleep/wake cycles
+  long memory_kb{0};     // touched once per period, a byte per page
+  bool random_touch{false};
+  long io_kb{0};         // written and synced once per period
+  long duration_s{0};    // 0 runs until stopped
+  uint64_t seed{1};      // random touches, offset per worker
+
+  // Reads "cpu=0.5,period=100,mem=4096,touch=random,io=64,duration=15",
+  // every key optional, throws std::invalid_argument if malformed
+  static WorkerSpec Parse(std::string const &text);
+  std::string Text() const;
+};
+
+class LoadGenerator {
+public:
+  LoadGenerator() = default;
+  ~LoadGenerator();
+  LoadGenerator(LoadGenerator const &) = delete;
+  LoadGenerator &operator=(LoadGenerator const &) = delete;
+
+  // Starts a worker, throws std::runtime_error if it cannot be spawned
+  pid_t Spawn(WorkerSpec spec);
+  void Pause(size_t worker);
+  void Resume(size_t worker);
+  std::vector<pid_t> const &Workers() const;
+  // Reaps the workers that exited, returns how many are left
+  size_t Reap();
+  // Terminates every worker and waits for each of them
+  void Stop();
+
+  // Body of a worker process, returns when its duration is over
+  static void RunWorker(WorkerSpec const &spec);
+
+private:
+  std::vector<pid_t> workers;
+  uint64_t spawned{0};
+};
+
+#endif
@@ -3,14 +3,39 @@
 
 #include <curses.h>
 
+#include "alerts.h"
+#include "cgroup.h"
+#include "exporter.h"
+#include "list_view.h"
+#include "network.h"
+#include "power.h"
 #include "process.h"
+#include "process_tree.h"
+#include "snapshot.h"
 #include "system.h"
 
 namespace NCursesDisplay {
-void Display(System &system, int n = 10);
+// Columns of the process list
+enum Columns { kCpuColumns_ = 0, kMemoryColumns_, kNetworkColumns_ };
+
+void Display(System &system, int n = 10,
+             std::string const &profile_path = "",
+             Exporter *exporter = nullptr, Alerts *alerts = nullptr);
+void DisplayRemote(std::vector<std::string> const &addresses, int n = 10,
+                   Alerts *alerts = nullptr);
 void DisplaySystem(System &system, WINDOW *window);
-void DisplayProcesses(std::vector<Process> &processes, WINDOW *window, int n);
-std::string ProgressBar(float percent);
+void DisplaySystem(SystemSnapshot const &system, WINDOW *window);
+void DisplayProcesses(std::vector<Process> &processes, WINDOW *window,
+                      ListView const &view, Columns columns = kCpuColumns_);
+void DisplayTree(std::vector<ProcessTree::Row> const &rows, WINDOW *window,
+                 ListView const &view);
+void DisplayCgroups(std::vector<Cgroup> &cgroups, WINDOW *window,
+                    ListView const &view);
+void DisplayInstrumentation(WINDOW *window);
+void DisplayAlerts(Alerts const &alerts, WINDOW *window);
+void DisplayPower(Power const &power, WINDOW *window);
+void DisplayNetwork(Network const &network, WINDOW *window);
+std::string const &ProgressBar(float percent);
 }; // namespace NCursesDisplay
 
 #endif
\ No newline at end of file
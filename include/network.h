@@ -0,0 +1,102 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*
+Interface throughput and per-process sockets
+Interfaces come from /proc/net/dev through a kept-open descriptor. The
+TCP and UDP sockets of the system come from one NETLINK_SOCK_DIAG dump
+per family and protocol, with tcp_info for the TCP byte counters, or
+from /proc/net/{tcp,udp}[6] without byte counters where the dump is
+refused.
+Sockets carry an inode but no owner. Owners are found by reading the
+socket links of /proc/<pid>/fd, which is the expensive part, so inode to
+pid is cached: a refresh only walks descriptor tables while some socket
+is unknown, new processes first, then the processes already owning
+sockets, then the rest round robin, at most kWalkBudget per refresh. A
+socket still unknown after a whole round (another namespace, a process
+we may not inspect) is not searched for again.
+*/
+class Network {
+public:
+  enum State { kEstablished_ = 0, kListen_, kOther_, kStateCount_ };
+  // Descriptor tables read per refresh at most
+  static constexpr int kWalkBudget{512};
+
+  struct Interface {
+    std::string name;
+    double rx{0.0}; // bytes/s
+    double tx{0.0};
+    unsigned long long rx_bytes{0};
+    unsigned long long tx_bytes{0};
+  };
+  // The sockets of one process
+  struct Sockets {
+    int states[kStateCount_]{};
+    double rx{0.0}; // TCP payload bytes/s
+    double tx{0.0};
+    int Count() const;
+  };
+
+  Network();
+  ~Network();
+  Network(Network const &) = delete;
+  Network &operator=(Network const &) = delete;
+
+  void SampleInterfaces();
+  std::vector<Interface> const &Interfaces() const;
+  void SampleSockets(std::vector<int> const &pids);
+  Sockets Of(int pid) const;
+  bool Diag() const;
+  long Walks() const;
+
+private:
+  struct Socket {
+    unsigned long inode;
+    State state;
+    unsigned uid;
+    // Cumulative TCP payload bytes, 0 for UDP or without sock_diag
+    unsigned long long rx;
+    unsigned long long tx;
+    bool operator<(Socket const &other) const { return inode < other.inode; }
+  };
+
+  bool Dump(int family, int protocol);
+  void ReadTable(const char *path);
+  int Walk(int pid);
+  bool Unknown(unsigned long inode) const;
+
+  int dev_fd{-1};
+  std::vector<char> dev;
+  std::vector<Interface> interfaces;
+  double interfaces_time{0.0};
+
+  int diag_fd{-1};
+  std::vector<char> message;
+  std::vector<Socket> sockets;
+  double sockets_time{0.0};
+  // The cache: socket inode to owning pid
+  std::unordered_map<unsigned long, int> owners;
+  // Unknown inodes and the value of steps when they were first missed
+  std::unordered_map<unsigned long, long> pending;
+  std::unordered_set<unsigned long> orphans;
+  std::vector<int> live;
+  std::vector<int> known;
+  std::vector<int> order;
+  // Round robin position, and steps taken, over live
+  size_t cursor{0};
+  long steps{0};
+  long walks{0};
+  // Payload counters of the previous refresh, rates are their deltas
+  std::unordered_map<unsigned long, std::pair<unsigned long long,
+                                              unsigned long long>> bytes;
+  std::unordered_map<unsigned long, std::pair<unsigned long long,
+                                              unsigned long long>> next_bytes;
+  std::unordered_map<int, Sockets> processes;
+};
+
+#endif
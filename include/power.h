@@ -0,0 +1,66 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*
+CPU frequency and energy from sysfs
+Current core frequencies come from cpufreq, package and sub-zone energy
+counters from the RAPL powercap zones, both through descriptors kept
+open between samples. Either source may be missing (virtual machines,
+no cpufreq driver, energy_uj readable by root only), its values are then
+reported as absent rather than as zero.
+*/
+class Power {
+public:
+  // An energy counter: a package, or a core/uncore/dram part of one
+  struct Zone {
+    std::string name;
+    int depth; // 0 for packages
+    double watts;
+  };
+
+  explicit Power(std::string const &sysfs = "/sys");
+  ~Power();
+  Power(Power const &) = delete;
+  Power &operator=(Power const &) = delete;
+
+  void Sample();
+  bool HasFrequency() const;
+  float Frequency() const;
+  float MaxFrequency() const;
+  float WeightedUtilization() const;
+  std::vector<Zone> const &Zones() const;
+
+private:
+  struct Core {
+    int cpu;
+    std::string path;
+    int fd{-1};
+    long max_khz;
+    long khz{0};
+    // Jiffies of the cpu<N> line of /proc/stat at the previous sample
+    long busy{-1};
+    long total{-1};
+    float utilization{0.0};
+  };
+  struct Counter {
+    std::string path;
+    int fd{-1};
+    long long range; // the counter wraps at this many microjoules
+    long long last{-1};
+  };
+
+  void SampleCores();
+
+  std::vector<Core> cores;
+  std::vector<Counter> counters;
+  std::vector<Zone> zones;
+  std::vector<char> stat;
+  int stat_fd{-1};
+  std::chrono::steady_clock::time_point last_sample{};
+};
+
+#endif
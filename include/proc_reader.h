@@ -0,0 +1,52 @@
+#ifndef PROC_READER_H
+#define PROC_READER_H
+
+#include <memory>
+#include <vector>
+
+/*
+Batched reads of the per-process files of /proc
+The synchronous backend reads a file when it is asked for, an open, a
+read and a close each. The io_uring backend queues the same three
+operations for every file of a batch of processes, linked so that each
+read uses the descriptor its open produced, and submits the whole batch
+with one io_uring_enter. Opens go to direct descriptors, slots of a table
+registered with the ring, so no file descriptor is ever installed.
+When io_uring is unavailable (kernel before 5.19, seccomp filters,
+kernel.io_uring_disabled) the reader stays synchronous, and it turns
+synchronous for good if io_uring_enter fails.
+*/
+class ProcReader {
+public:
+  enum File { kStat_ = 0, kStatus_, kIo_, kFileCount_ };
+  // Processes read per submission
+  static constexpr int kBatch{256};
+
+  ProcReader();
+  ~ProcReader();
+  ProcReader(ProcReader const &) = delete;
+  ProcReader &operator=(ProcReader const &) = delete;
+
+  bool EnableUring();
+  bool Uring() const;
+  void Read(int const *pids, int count);
+  const char *Contents(int i, File file);
+  long Syscalls() const;
+
+private:
+  struct Ring;
+
+  char *Buffer(int i, File file);
+  void Abandon();
+
+  std::unique_ptr<Ring> ring;
+  int const *pids{nullptr};
+  // Per file of the batch: bytes read, -1 if unreadable, -2 if not read yet
+  std::vector<int> lengths;
+  std::vector<char> buffers;
+  // Buffers of a batch abandoned with operations in flight
+  std::vector<char> retired;
+  long syscalls{0};
+};
+
+#endif
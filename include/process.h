@@ -1,26 +1,92 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
-#include <string>
+#include <string_view>
+
+#include "linux_parser.h"
+#include "network.h"
+#include "trend.h"
+
 /*
 Basic class for Process representation
 It contains relevant attributes as shown below
+Strings are views into the owning System's string pool
 */
 class Process {
 public:
-  Process(int PID);
+  explicit Process(int PID);
   int Pid() const;
-  std::string User();
-  std::string Command();
-  void updateCpuUtilization();
+  int Ppid() const;
+  std::string_view User() const;
+  std::string_view Command() const;
+  std::string_view Comm() const;
+  std::string_view Cgroup() const;
   float getCpuUtilization() const;
-  std::string Ram();
-  long int UpTime();
+  long int ArrivalTime() const;
+  long int BurstTime() const;
+  long int RemainingTime() const;
+  char Status() const;
+  long int Ram() const;
+  long int Resident() const;
+  long int UpTime() const;
+  int Nice() const;
+  long int CpuDelta() const;
+  double IoRate() const;
+  double SwitchRate() const;
+  double Growth() const;
+  bool Growing() const;
+  LinuxParser::ProcessMemory const &Memory() const;
+  Network::Sockets const &Sockets() const;
   bool operator<(Process const &a) const;
 
+  void Update(LinuxParser::ProcessStat const &stat,
+              LinuxParser::ProcessStatus const &status,
+              LinuxParser::ProcessIo const &io, long uptime, double now);
+  void Restore(char status, float cpu_utilization, long int ram,
+               long int arrival_time, long int burst_time, long int up_time);
+  void SetMemory(LinuxParser::ProcessMemory const &memory);
+  void SetSockets(Network::Sockets const &sockets);
+  void SetComm(std::string_view comm);
+  void SetCommand(std::string_view command);
+  void SetUser(std::string_view user);
+  void SetCgroup(std::string_view cgroup);
+
 private:
   int pid;
+  int ppid{0};
   float cpu_utilization{0.0};
+  char status{'?'};
+  long int arrival_time{0};
+  long int burst_time{0};
+  long int up_time{0};
+  long int ram{0}; // resident MB
+  long int resident{0}; // kB
+  int nice{0};
+  // CPU time in ms used since the previous update
+  long int cpu_delta{0};
+  // Start time in jiffies, tells a reused pid apart
+  long int start_time{-1};
+  // Address of the program text, moves when the process execs
+  long int start_code{-1};
+  // CPU jiffies and wall time (seconds) at the previous update
+  long int prev_jiffies{-1};
+  // Bytes read and written from storage, at the previous update
+  long int prev_io{0};
+  // Storage bytes per second since the previous update
+  double io_rate{0.0};
+  long int prev_switches{0};
+  double switch_rate{0.0};
+  // Resident plus swapped kB, sampled every kTrendSpacing seconds
+  Trend footprint{};
+  // Detail read for the largest and the growing processes only
+  LinuxParser::ProcessMemory memory{};
+  // Set while socket accounting is enabled, see System
+  Network::Sockets sockets{};
+  double prev_now{0.0};
+  std::string_view comm{};
+  std::string_view command{};
+  std::string_view user{};
+  std::string_view cgroup{};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,76 @@
+#ifndef PROCESS_TREE_H
+#define PROCESS_TREE_H
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "process.h"
+
+/*
+Parent/child index of the scanned processes, built from the PPID field
+Children hang off their parent in an intrusive doubly linked list, so
+adding, removing or reparenting a process is O(1) and a scan only
+touches the processes that appeared, exited or changed parent. Processes
+whose parent is not scanned (pid 1, kthreadd, filtered-out parents) are
+roots under the sentinel pid 0; those still naming a parent pid wait in
+a map keyed by it, so a parent scanned after its children finds them
+without walking the roots.
+*/
+class ProcessTree {
+public:
+  // A line of the tree view, Process pointers are valid until the next scan
+  struct Row {
+    Process const *process;
+    int depth;
+    bool children;
+    bool collapsed;
+    // The process and all its descendants, collapsed or not
+    float cpu;
+    long ram;
+  };
+
+  ProcessTree();
+  void Update(int pid, int ppid);
+  void Remove(int pid);
+  void Toggle(int pid);
+  size_t Size() const;
+  std::vector<Row> const &Flatten(std::vector<Process> const &records);
+
+private:
+  struct Node {
+    int ppid{0};   // as reported, the parent may not be scanned
+    int parent{0}; // node linked under
+    int first_child{-1};
+    int last_child{-1};
+    int prev{-1};
+    int next{-1};
+    int slot{-1};
+    bool collapsed{false};
+  };
+  // A node in depth-first order while flattening
+  struct Entry {
+    int slot;
+    int depth;
+    int parent; // index in order, -1 for roots
+    bool children;
+    bool collapsed;
+    float cpu;
+    long ram;
+  };
+
+  void Link(int pid, Node &node, int parent);
+  void Unlink(Node &node);
+  void Wait(int pid, Node const &node);
+  void StopWaiting(int pid, Node const &node);
+
+  std::unordered_map<int, Node> nodes;
+  // ppid to the pids linked under the root until that parent is scanned
+  std::unordered_multimap<int, int> waiting;
+  std::vector<Entry> order;
+  // (pid, index of the parent in order) still to visit
+  std::vector<std::pair<int, int>> stack;
+  std::vector<Row> rows;
+};
+
+#endif
@@ -4,6 +4,7 @@
 class Processor {
 public:
   float Utilization();
+  float LastUtilization() const;
 
 private:
   // Jiffies from previous state
@@ -15,6 +16,8 @@ private:
   long int previrq{-1};
   long int prevsoftirq{-1};
   long int prevsteal{-1};
+  // Result of the last call to Utilization()
+  float utilization{0.0};
 };
 
 #endif
\ No newline at end of file
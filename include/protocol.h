@@ -0,0 +1,98 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "process.h"
+#include "snapshot.h"
+#include "string_pool.h"
+
+/*
+Binary protocol between an agent and its viewers
+A frame is a 4 byte little-endian payload length followed by the
+payload. Numbers are LEB128 varints. The first frame of a connection is
+a keyframe; later frames only carry the processes that appeared,
+changed or exited since the previous frame, and only their changed
+fields. Strings are sent once and referenced by id afterwards. Once the
+strings sent pass kMaxStringBytes the encoder forgets them and sends a
+reset frame: a delta after which ids start again from 0 and every row
+references its strings anew, so neither side keeps the strings of
+processes long gone.
+*/
+namespace Protocol {
+// Strings defined on a connection before both sides start over
+constexpr size_t kMaxStringBytes{4 * 1024 * 1024};
+
+// Connections: "unix:<path>" or "<host>:<port>", throw std::runtime_error
+int Listen(std::string const &address);
+int Connect(std::string const &address);
+
+// One row as sent on the wire
+struct Row {
+  int pid;
+  char status;
+  uint32_t cpu; // 1/10000
+  long ram;
+  long arrival;
+  long burst;
+  uint32_t user;
+  uint32_t command;
+};
+
+// Per-connection encoder on the agent side
+class Encoder {
+public:
+  void Encode(SystemSnapshot const &system,
+              std::vector<Process> const &processes, std::string &frame);
+
+private:
+  uint32_t StringId(std::string_view s, std::string &out);
+
+  bool keyframe_sent_ = false;
+  // The string table was just dropped, every row redefines its strings
+  bool reset_ = false;
+  std::vector<Row> previous_ = {};
+  std::vector<Row> current_ = {};
+  // Strings this connection has been sent, keys point into pool_
+  StringPool pool_ = {};
+  std::unordered_map<std::string_view, uint32_t> strings_ = {};
+  // Sections of the frame being encoded
+  std::string definitions_ = {};
+  unsigned long new_strings_ = 0;
+  std::string removed_ = {};
+  std::string upserted_ = {};
+};
+
+// Per-connection decoder on the viewer side
+class Decoder {
+public:
+  // Consumes complete frames from the front of buffer, false if malformed
+  bool Consume(std::string &buffer);
+  SystemSnapshot const &System() const;
+  std::vector<Process> &Processes();
+  size_t LastFrameBytes() const;
+
+private:
+  bool Decode(const char *data, const char *end);
+  void ResetStrings();
+
+  SystemSnapshot system_ = {};
+  // Sorted by pid to apply deltas, and by CPU utilization to show
+  std::vector<Process> processes_ = {};
+  std::vector<Process> next_ = {};
+  std::vector<Process> sorted_ = {};
+  std::vector<int> removed_ = {};
+  StringPool strings_ = {};
+  // The pool before the last reset, the rows shown keep pointing into
+  // it if the frame that resets fails to decode
+  StringPool retired_ = {};
+  std::vector<std::string_view> table_ = {};
+  size_t last_frame_bytes_ = 0;
+};
+}; // namespace Protocol
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <chrono>
+#include <vector>
+
+#include "process.h"
+
+/*
+Tiered sampling schedule
+System counters are sampled at a fixed fast rate, the per-process scan
+backs off while the process set and top-n are stable and speeds up again
+when the CPU or CPU pressure spikes
+*/
+class Sampler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  bool SystemDue(Clock::time_point now);
+  bool ProcessesDue(Clock::time_point now);
+  void ObserveSystem(float cpu_utilization, float cpu_pressure);
+  void ObserveProcesses(std::vector<Process> const &processes, int n);
+  std::chrono::milliseconds ProcessInterval() const;
+  void SpeedUp();
+
+  // Bounds of the schedule
+  static constexpr std::chrono::milliseconds kSystemInterval{250};
+  static constexpr std::chrono::milliseconds kMinProcessInterval{500};
+  static constexpr std::chrono::milliseconds kMaxProcessInterval{8000};
+
+private:
+  Clock::time_point next_system_ = {};
+  Clock::time_point next_processes_ = {};
+  std::chrono::milliseconds process_interval_ = kMinProcessInterval;
+  float prev_cpu_ = -1;
+  // Signature of the last scan: number of pids, pid hash and top-n pids
+  size_t prev_count_ = 0;
+  unsigned long prev_hash_ = 0;
+  std::vector<int> prev_top_ = {};
+};
+
+#endif
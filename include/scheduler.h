@@ -0,0 +1,161 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+/*
+CPU scheduling simulator
+Jobs are pulled from a JobSource as simulated time reaches their
+arrival, so the input is streamed and only runnable jobs are held in
+memory. Time is in ticks, a trace uses one tick per millisecond.
+*/
+namespace Scheduler {
+struct Job {
+  int pid;
+  long arrival;
+  long burst;
+  int priority; // nice, lower runs first
+  uint64_t affinity{~0ULL}; // cores it may run on, one bit each
+};
+
+// Jobs in non-decreasing arrival order
+class JobSource {
+public:
+  virtual ~JobSource() = default;
+  virtual bool Next(Job &job) = 0;
+};
+
+class VectorSource : public JobSource {
+public:
+  explicit VectorSource(std::vector<Job> jobs);
+  bool Next(Job &job) override;
+
+private:
+  std::vector<Job> jobs;
+  size_t next{0};
+};
+
+// A job while it is simulated
+// Lifecycle of a simulated task, one byte
+enum TaskState : uint8_t { kWaiting_ = 0, kReady_, kRunning_, kDone_ };
+
+const char *StateName(TaskState state);
+
+// Fixed-point shift of virtual runtimes
+constexpr int kFairShift{20};
+
+struct Task {
+  Job job;
+  long remaining;
+  long first_run;
+  int level; // MLFQ queue
+  int core;  // last core it ran on, -1 before its first run
+  long vruntime; // fair scheduler, scaled by kFairShift
+};
+
+// Run-queue discipline
+class Policy {
+public:
+  virtual ~Policy() = default;
+  virtual const char *Name() const = 0;
+  // Whether arrivals may ever take the CPU from the running task
+  virtual bool Preemptive() const { return false; }
+  virtual bool ShouldPreempt(Task const & /*running*/,
+                             Task const & /*arrived*/) const {
+    return false;
+  }
+  virtual void Enqueue(Task *task, long now) = 0;
+  virtual Task *PickNext(long now) = 0;
+  // Ticks the picked task may run before the next decision
+  virtual long Slice(Task const &task) const = 0;
+  // Accounting when the task leaves the CPU after running ran ticks,
+  // expired if it used its whole slice
+  virtual void Ran(Task & /*task*/, long /*ran*/, bool /*expired*/) {}
+  // Removes a queued task for another core, one unlikely to run soon
+  virtual Task *Steal() = 0;
+  // Enqueues a task stolen from another queue of the same kind
+  virtual void Adopt(Task *task, long now) { Enqueue(task, now); }
+  virtual size_t Size() const = 0;
+  bool Empty() const { return Size() == 0; }
+};
+
+enum PolicyKind {
+  kFcfs_ = 0,
+  kRoundRobin_,
+  kSrtf_,
+  kMlfq_,
+  kHybrid_,
+  kFair_,
+  kPolicyCount_
+};
+
+// How work is spread over several cores
+enum Balance {
+  kGlobal_ = 0,   // one run queue shared by every core
+  kPushPull_,     // per-core queues, periodic rebalancing and idle pulls
+  kWorkStealing_, // per-core queues, idle cores steal from a random victim
+  kBalanceCount_
+};
+
+struct Options {
+  long quantum{2};
+  int mlfq_levels{3};
+  long mlfq_boost{100};
+  int hybrid_buckets{4};
+  long context_switch{0};
+  // Fair scheduler: every runnable task runs once per latency target,
+  // but never for less than the minimum granularity
+  long fair_latency{6};
+  long fair_min_granularity{1};
+  int cores{1};
+  Balance balance{kGlobal_};
+  // Ticks a task loses refilling caches after running on another core
+  long migration_cost{0};
+  long balance_interval{4};
+};
+
+std::unique_ptr<Policy> MakePolicy(PolicyKind kind, Options const &options);
+const char *BalanceName(Balance balance);
+
+struct Result {
+  std::string policy;
+  long jobs{0};
+  double turnaround{0.0};
+  double waiting{0.0};
+  double response{0.0};
+  Histogram waiting_histogram{};
+  long makespan{0};
+  long busy{0};
+  long dispatches{0};
+  long context_switches{0};
+  // Jain's index of the slowdowns (turnaround / burst), 1 when every job
+  // is slowed down alike
+  double fairness{0.0};
+  // Set by SimulateCores
+  std::string balance{};
+  long migrations{0};
+  std::vector<long> core_busy{};
+};
+
+Result Simulate(Policy &policy, JobSource &source, Options const &options);
+// Same without a virtual call per scheduling decision
+Result Simulate(PolicyKind kind, JobSource &source, Options const &options);
+// Simulates options.cores CPUs, each with its own kind of run queue
+// unless the balance is kGlobal_
+Result SimulateCores(PolicyKind kind, JobSource &source,
+                     Options const &options);
+std::string FormatHeader();
+std::string FormatResult(Result const &result);
+std::string FormatCoresHeader();
+std::string FormatCoresResult(Result const &result);
+}; // namespace Scheduler
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+#include "system.h"
+
+/*
+Recorded monitoring sessions and the comparison of two of them
+One line per process and sample, tab separated:
+  <ms> <pid> <cpu %> <rss kB> <io B/s> <context switches/s> <cgroup>
+  <command>
+lines starting with # are comments. Tabs and newlines in commands
+become spaces.
+Diff joins processes on (command, cgroup). The first session is folded
+into a hash table of running statistics per identity, the second is
+streamed against it, so memory grows with the number of distinct
+processes and not with the length of the recordings.
+*/
+namespace Session {
+enum Metric { kCpu_ = 0, kRss_, kIo_, kSwitches_, kMetricCount_ };
+
+struct Sample {
+  long time; // ms since the start of the session
+  int pid;
+  double values[kMetricCount_];
+  std::string cgroup;
+  std::string command;
+};
+
+// Streams a session, memory use does not depend on its length
+class Reader {
+public:
+  // Throws std::runtime_error if the file cannot be opened
+  explicit Reader(std::string const &path);
+  ~Reader();
+  Reader(Reader const &) = delete;
+  Reader &operator=(Reader const &) = delete;
+  // Throws std::runtime_error on a malformed line
+  bool Next(Sample &sample);
+
+private:
+  FILE *file;
+  std::string path;
+  char *buffer{nullptr};
+  size_t capacity{0};
+  long line{0};
+};
+
+// Samples system every interval_ms for seconds and writes the session to
+// path, throws std::runtime_error if the file cannot be written
+void Record(System &system, std::string const &path, int seconds,
+            int interval_ms = 1000);
+
+// Running mean and variance (Welford), constant memory
+struct Moments {
+  void Add(double value);
+  double Variance() const;
+
+  long n{0};
+  double mean{0.0};
+  double m2{0.0};
+  double max{0.0};
+};
+
+// One process identity in both sessions
+struct Delta {
+  std::string cgroup;
+  std::string command;
+  Moments before[kMetricCount_];
+  Moments after[kMetricCount_];
+  // Whether the means differ at 95% by Welch's t-test. Samples of one
+  // process are correlated in time, so treat it as a ranking aid rather
+  // than an exact error rate.
+  bool Significant(Metric metric) const;
+};
+
+struct Report {
+  // Identities sampled in both sessions, heaviest CPU increase first
+  std::vector<Delta> deltas;
+  // Every sample of each session, cpu and switches in hundredths
+  Histogram before[kMetricCount_];
+  Histogram after[kMetricCount_];
+  long added{0}; // identities only in the second session
+  long gone{0};  // only in the first
+};
+
+// Throws std::runtime_error if a session cannot be read
+Report Diff(std::string const &before, std::string const &after);
+std::string FormatReport(Report const &report);
+}; // namespace Session
+
+#endif
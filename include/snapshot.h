@@ -0,0 +1,17 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string_view>
+
+// System-wide values shown in the system window
+struct SystemSnapshot {
+  std::string_view operating_system{};
+  std::string_view kernel{};
+  float cpu{0.0};
+  float memory{0.0};
+  int total_processes{0};
+  int running_processes{0};
+  long uptime{0};
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/*
+Interns strings into large arena chunks
+Equal strings share one copy, views stay valid for the pool's lifetime
+*/
+class StringPool {
+public:
+  std::string_view Intern(std::string_view s);
+  size_t Bytes() const;
+  size_t Size() const;
+
+private:
+  static constexpr size_t kChunkSize{64 * 1024};
+
+  std::vector<std::unique_ptr<char[]>> chunks_ = {};
+  // Chunk being filled, oversized strings never become current
+  char *current_ = nullptr;
+  size_t used_ = kChunkSize;
+  size_t bytes_ = 0;
+  std::unordered_set<std::string_view> index_ = {};
+};
+
+#endif
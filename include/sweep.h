@@ -0,0 +1,61 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "scheduler.h"
+
+/*
+Monte-Carlo sweep of scheduler settings
+Every setting is simulated on the same seeded random workloads, so
+settings are compared on identical load, and the results do not depend
+on the number of threads or on their timing.
+*/
+namespace Sweep {
+// Random workload at ~90% load: mostly short interactive bursts, a fifth
+// CPU-bound ones, Poisson arrivals and uniform nice values
+class RandomSource : public Scheduler::JobSource {
+public:
+  RandomSource(uint64_t seed, long jobs);
+  bool Next(Scheduler::Job &job) override;
+
+private:
+  std::mt19937_64 random;
+  long remaining;
+  long now{0};
+  int pid{0};
+};
+
+struct Setting {
+  Scheduler::PolicyKind kind;
+  Scheduler::Options options;
+};
+
+// Mean over the workloads of per-workload figures, each with the half
+// width of its 95% confidence interval
+struct Summary {
+  Setting setting;
+  double wait;
+  double wait_ci;
+  double wait_p99;
+  double wait_p99_ci;
+  double turnaround;
+  double turnaround_ci;
+  double switches;
+};
+
+std::vector<Setting> Grid();
+// Simulates every setting on workloads random workloads of jobs jobs,
+// threads <= 0 uses every core
+std::vector<Summary> Run(std::vector<Setting> const &settings, int workloads,
+                         long jobs, uint64_t seed, int threads = 0);
+std::string FormatHeader();
+std::string FormatSummary(Summary const &summary);
+// Two-sided 95% Student t quantile for n - 1 degrees of freedom
+double TQuantile(int n);
+}; // namespace Sweep
+
+#endif
@@ -2,26 +2,91 @@
 #define SYSTEM_H
 
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "cgroup.h"
+#include "filter.h"
+#include "network.h"
 #include "process.h"
+#include "proc_reader.h"
+#include "process_tree.h"
 #include "processor.h"
+#include "snapshot.h"
+#include "string_pool.h"
 
 class System {
 public:
+  // Order of the records returned by Processes()
+  enum Order { kByCpu_ = 0, kByGrowth_, kByNetwork_ };
+
   Processor &Cpu();
   std::vector<Process> &Processes();
+  std::vector<Cgroup> &Cgroups();
+  std::vector<ProcessTree::Row> const &Tree();
+  void ScanAll(bool enabled);
+  std::vector<Process> const &AllProcesses() const;
+  void ToggleSubtree(int pid);
+  void SetFilter(Filter filter);
+  Filter const &ProcessFilter() const;
+  void SetOrder(Order order);
+  bool EnableUring();
+  ProcReader const &Reader() const;
+  void EnableSockets(bool enabled);
+  Network &Net();
   float MemoryUtilization();
   long UpTime();
   int TotalProcesses();
   int RunningProcesses();
-  std::string Kernel();
-  std::string OperatingSystem();
+  std::string const &Kernel();
+  std::string const &OperatingSystem();
+  SystemSnapshot Snapshot();
 
 private:
+  std::string_view UserName(int uid);
+  void CompactStrings();
+  void ReadMemoryDetail(std::vector<Process> &records);
+  bool Filtering() const;
+
   // Composition: System "has a" Processor called cpu
   Processor cpu_ = {};
+  // Process records, double buffered so that a refresh reuses both slabs
   std::vector<Process> processes_ = {};
+  std::vector<Process> next_ = {};
+  std::vector<int> pids_ = {};
+  // Pids passing the filter stages that need no read, read in batches
+  std::vector<int> candidates_ = {};
+  // Whether each candidate passed the pid stage
+  std::vector<bool> passed_ = {};
+  // Whether the filter only selects what is shown, see ScanAll()
+  bool scan_all_ = false;
+  ProcReader reader_ = {};
+  Order order_ = kByCpu_;
+  // Slots of the records with the largest footprints
+  std::vector<int> largest_ = {};
+  // Records that also pass the last filter stage, see Filter
+  Filter filter_ = {};
+  std::vector<Process> filtered_ = {};
+  // (pid, slot in processes_) sorted by pid
+  std::vector<std::pair<int, int>> index_ = {};
+  // Slots of processes_ still alive in the current scan
+  std::vector<bool> carried_ = {};
+  Network network_ = {};
+  // Whether each scan also lists sockets and attributes them
+  bool sockets_ = false;
+  // Updated with the processes that appear, exit or change parent only
+  ProcessTree tree_ = {};
+  std::vector<Cgroup> cgroups_ = {};
+  // (path, slot in cgroups_) sorted by interned path address
+  std::vector<std::pair<const char *, size_t>> cgroup_index_ = {};
+  // Commands and user names repeat heavily, Process only holds views
+  StringPool strings_ = {};
+  std::unordered_map<int, std::string_view> users_ = {};
+  // Never change while running, read once
+  std::string kernel_ = {};
+  std::string operating_system_ = {};
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,42 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdio>
+#include <string>
+
+#include "scheduler.h"
+#include "system.h"
+
+/*
+Workload traces for the scheduling simulator
+One job per line: "<arrival ms> <pid> <burst ms> <nice> [<hex core
+mask>]", in arrival order, lines starting with # are comments. A
+recorded job is the CPU time a process used during one sampling
+interval, arriving at its start.
+*/
+namespace Trace {
+// Streams a trace, memory use does not depend on its length
+class Reader : public Scheduler::JobSource {
+public:
+  // Throws std::runtime_error if the file cannot be opened
+  explicit Reader(std::string const &path);
+  ~Reader() override;
+  Reader(Reader const &) = delete;
+  Reader &operator=(Reader const &) = delete;
+  // Throws std::runtime_error on a malformed or out of order line
+  bool Next(Scheduler::Job &job) override;
+
+private:
+  FILE *file;
+  std::string path;
+  long line{0};
+  long last_arrival{0};
+};
+
+// Samples system every interval_ms for seconds and writes the trace to
+// path, throws std::runtime_error if the file cannot be written
+void Record(System &system, std::string const &path, int seconds,
+            int interval_ms = 100);
+}; // namespace Trace
+
+#endif
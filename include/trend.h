@@ -0,0 +1,35 @@
+#ifndef TREND_H
+#define TREND_H
+
+#include <array>
+
+/*
+Least-squares slope over the most recent samples of a series
+A fixed ring with running sums, so adding a sample costs at most
+kCapacity steps and no heap memory, records holding one stay cheap to
+copy. Times are kept relative to the oldest sample, so the sums keep
+their precision however long the series runs.
+*/
+class Trend {
+public:
+  void Add(double time, double value);
+  double Slope() const;
+  int Count() const;
+  double LastTime() const;
+
+private:
+  static constexpr int kCapacity{32};
+
+  // Times are relative to the oldest sample, floats are plenty
+  std::array<float, kCapacity> times{};
+  std::array<float, kCapacity> values{};
+  int first{0};
+  int count{0};
+  double origin{0.0};
+  double sum_t{0.0};
+  double sum_v{0.0};
+  double sum_tt{0.0};
+  double sum_tv{0.0};
+};
+
+#endif
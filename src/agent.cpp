@@ -0,0 +1,126 @@
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "agent.h"
+#include "linux_parser.h"
+#include "protocol.h"
+#include "sampler.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+// Unsent bytes past which a viewer gets no new frames until it catches up
+constexpr size_t kMaxBacklog{1024 * 1024};
+
+struct Viewer {
+  int fd;
+  Protocol::Encoder encoder;
+  // Encoded frames not yet taken by the socket, from sent on
+  string pending;
+  size_t sent;
+};
+
+// Sends what the socket takes without blocking, false if the viewer is gone
+bool Flush(Viewer &viewer) {
+  while (viewer.sent < viewer.pending.size()) {
+    ssize_t n = send(viewer.fd, viewer.pending.data() + viewer.sent,
+                     viewer.pending.size() - viewer.sent,
+                     MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    viewer.sent += n;
+  }
+  viewer.pending.clear();
+  viewer.sent = 0;
+  return true;
+}
+} // namespace
+
+// Samples on the Sampler schedule, a frame goes out whenever a tier is due.
+// Sockets never block the loop: frames queue per viewer and drain when
+// poll reports the viewer writable. A viewer whose queue passes
+// kMaxBacklog is skipped until it drains; its encoder is not advanced, so
+// its next frame is one delta covering everything it missed.
+void Agent::Serve(System &system, string const &address, int n) {
+  int listen_fd = Protocol::Listen(address);
+  vector<Viewer> viewers;
+  vector<pollfd> fds;
+  Sampler sampler;
+  SystemSnapshot snapshot;
+  vector<Process> *processes = nullptr;
+  string frame;
+
+  while (true) {
+    fds.clear();
+    fds.push_back({listen_fd, POLLIN, 0});
+    for (Viewer const &viewer : viewers) {
+      fds.push_back({viewer.fd,
+                     static_cast<short>(viewer.pending.empty()
+                                            ? POLLIN
+                                            : POLLIN | POLLOUT),
+                     0});
+    }
+    poll(fds.data(), fds.size(), 100);
+
+    // Viewers never send, readable means they hung up
+    vector<bool> gone(viewers.size(), false);
+    for (size_t i = 0; i < viewers.size(); ++i) {
+      gone[i] = (fds[i + 1].revents & (POLLIN | POLLERR | POLLHUP)) != 0;
+      if (!gone[i] && (fds[i + 1].revents & POLLOUT)) {
+        gone[i] = !Flush(viewers[i]);
+      }
+    }
+    if (fds[0].revents & POLLIN) {
+      int fd = accept4(listen_fd, nullptr, nullptr,
+                       SOCK_CLOEXEC | SOCK_NONBLOCK);
+      if (fd >= 0) {
+        viewers.push_back({fd, {}, {}, 0});
+        gone.push_back(false);
+        // Give the new viewer its keyframe right away
+        sampler.SpeedUp();
+      }
+    }
+
+    auto now = Sampler::Clock::now();
+    bool due{false};
+    if (sampler.SystemDue(now)) {
+      snapshot = system.Snapshot();
+      sampler.ObserveSystem(snapshot.cpu, LinuxParser::CpuPressure());
+      due = true;
+    }
+    if (sampler.ProcessesDue(now) || processes == nullptr) {
+      processes = &system.Processes();
+      sampler.ObserveProcesses(*processes, n);
+      due = true;
+    }
+    for (size_t i = 0; due && i < viewers.size(); ++i) {
+      Viewer &viewer = viewers[i];
+      if (gone[i] || viewer.pending.size() - viewer.sent > kMaxBacklog) {
+        continue;
+      }
+      viewer.encoder.Encode(snapshot, *processes, frame);
+      viewer.pending.erase(0, viewer.sent);
+      viewer.sent = 0;
+      viewer.pending += frame;
+      gone[i] = !Flush(viewer);
+    }
+
+    size_t kept{0};
+    for (size_t i = 0; i < viewers.size(); ++i) {
+      if (gone[i]) {
+        close(viewers[i].fd);
+      } else if (kept != i) {
+        viewers[kept++] = std::move(viewers[i]);
+      } else {
+        ++kept;
+      }
+    }
+    viewers.erase(viewers.begin() + kept, viewers.end());
+  }
+}
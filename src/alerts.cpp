@@ -0,0 +1,470 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <spawn.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <thread>
+
+#include "alerts.h"
+
+extern char **environ;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace {
+const char *const kScopes[] = {"system", "process", "cgroup"};
+const vector<vector<string>> kMetrics = {
+    {"cpu", "memory", "running", "pressure"},
+    {"cpu", "ram", "io"},
+    {"cpu", "memory", "read", "write"}};
+const char *const kAggregates[] = {"last", "avg", "min", "max", "rate"};
+
+// Reads a number, throws std::invalid_argument naming what it is
+double Number(string const &text, char const *what) {
+  char *end;
+  double number = std::strtod(text.c_str(), &end);
+  if (text.empty() || *end != '\0') {
+    throw std::invalid_argument(string("expected a number for ") + what +
+                                ", got '" + text + "'");
+  }
+  return number;
+}
+
+// Reads a duration such as 30, 30s, 500ms, 5m or 1h into seconds
+double Duration(string const &text, char const *what) {
+  char *end;
+  double number = std::strtod(text.c_str(), &end);
+  const string unit(end);
+  double scale{-1.0};
+  if (unit.empty() || unit == "s") {
+    scale = 1.0;
+  } else if (unit == "ms") {
+    scale = 0.001;
+  } else if (unit == "m") {
+    scale = 60.0;
+  } else if (unit == "h") {
+    scale = 3600.0;
+  }
+  if (text.empty() || end == text.c_str() || scale < 0 || number < 0) {
+    throw std::invalid_argument(string("expected a duration for ") + what +
+                                ", got '" + text + "'");
+  }
+  return number * scale;
+}
+
+// Whether value is past limit in the direction of the rule
+bool Breach(Alerts::Rule const &rule, double value, double limit) {
+  if (rule.above) {
+    return rule.inclusive ? value >= limit : value > limit;
+  }
+  return rule.inclusive ? value <= limit : value < limit;
+}
+} // namespace
+
+Alerts::Rule Alerts::Parse(string const &line) {
+  std::istringstream stream(line);
+  Rule rule{};
+  rule.text = line;
+  string metric;
+  string aggregate;
+  string window;
+  string op;
+  string threshold;
+  if (!(stream >> rule.name >> metric >> aggregate >> window >> op >>
+        threshold)) {
+    throw std::invalid_argument(
+        "expected <name> <scope>.<metric> <aggregate> <window> <op> "
+        "<threshold>");
+  }
+
+  const size_t dot = metric.find('.');
+  bool known{false};
+  for (int scope = kSystem_; scope <= kCgroup_ && !known; ++scope) {
+    if (dot == string::npos || metric.compare(0, dot, kScopes[scope]) != 0 ||
+        dot != std::strlen(kScopes[scope])) {
+      continue;
+    }
+    for (size_t m = 0; m < kMetrics[scope].size(); ++m) {
+      if (metric.compare(dot + 1, string::npos, kMetrics[scope][m]) == 0) {
+        rule.scope = static_cast<Scope>(scope);
+        rule.metric = m;
+        known = true;
+      }
+    }
+  }
+  if (!known) {
+    throw std::invalid_argument("unknown metric '" + metric + "'");
+  }
+
+  known = false;
+  for (int a = kLast_; a <= kRate_; ++a) {
+    if (aggregate == kAggregates[a]) {
+      rule.aggregate = static_cast<Aggregate>(a);
+      known = true;
+    }
+  }
+  if (!known) {
+    throw std::invalid_argument("unknown aggregate '" + aggregate + "'");
+  }
+  rule.window = Duration(window, "the window");
+  if (rule.aggregate == kRate_ && rule.window <= 0) {
+    throw std::invalid_argument("rate needs a window");
+  }
+
+  if (op == ">" || op == ">=" || op == "<" || op == "<=") {
+    rule.above = op[0] == '>';
+    rule.inclusive = op.size() == 2;
+  } else {
+    throw std::invalid_argument("expected one of > >= < <=, got '" + op +
+                                "'");
+  }
+  rule.threshold = Number(threshold, "the threshold");
+  rule.clear = rule.threshold;
+
+  string keyword;
+  string value;
+  while (stream >> keyword) {
+    if (!(stream >> value)) {
+      throw std::invalid_argument("missing value after '" + keyword + "'");
+    }
+    if (keyword == "clear") {
+      rule.clear = Number(value, "clear");
+      if (Breach(rule, rule.clear, rule.threshold) &&
+          rule.clear != rule.threshold) {
+        throw std::invalid_argument("clear must be on the safe side of the "
+                                    "threshold");
+      }
+    } else if (keyword == "for") {
+      rule.hold = Duration(value, "for");
+    } else {
+      throw std::invalid_argument("unknown keyword '" + keyword + "'");
+    }
+  }
+  return rule;
+}
+
+vector<Alerts::Rule> Alerts::Load(string const &path) {
+  std::ifstream stream(path);
+  if (!stream) {
+    throw std::runtime_error("cannot read " + path);
+  }
+  vector<Rule> rules;
+  string line;
+  for (int number = 1; std::getline(stream, line); ++number) {
+    const size_t start = line.find_first_not_of(" \t");
+    if (start == string::npos || line[start] == '#') {
+      continue;
+    }
+    try {
+      rules.push_back(Parse(line.substr(start)));
+    } catch (std::invalid_argument const &e) {
+      throw std::invalid_argument(path + ":" + std::to_string(number) + ": " +
+                                  e.what());
+    }
+  }
+  return rules;
+}
+
+Alerts::Alerts(vector<Rule> rules)
+    : rules(std::move(rules)), system(this->rules.size()),
+      processes(this->rules.size()), cgroups(this->rules.size()) {}
+
+Alerts::~Alerts() {
+  if (log != nullptr) {
+    std::fclose(log);
+  }
+  // Hooks still running get kHookWaitMs between them to finish
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(kHookWaitMs);
+  while (true) {
+    for (auto it = hooks.begin(); it != hooks.end();) {
+      it = waitpid(*it, nullptr, WNOHANG) != 0 ? hooks.erase(it) : it + 1;
+    }
+    if (hooks.empty() || std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+void Alerts::SetLog(string const &path) {
+  FILE *file = std::fopen(path.c_str(), "a");
+  if (file == nullptr) {
+    throw std::runtime_error("cannot append to " + path);
+  }
+  if (log != nullptr) {
+    std::fclose(log);
+  }
+  log = file;
+}
+
+void Alerts::SetHook(string const &command) { hook = command; }
+
+// Return whether any rule watches the scope
+bool Alerts::Has(Scope scope) const {
+  for (Rule const &rule : rules) {
+    if (rule.scope == scope) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Return the alerts currently firing
+vector<Alerts::Active> const &Alerts::Firing() const { return firing; }
+
+void Alerts::ObserveSystem(SystemSnapshot const &snapshot, float pressure,
+                           double now) {
+  for (size_t r = 0; r < rules.size(); ++r) {
+    if (rules[r].scope != kSystem_) {
+      continue;
+    }
+    double value{0.0};
+    switch (rules[r].metric) {
+    case 0:
+      value = snapshot.cpu * 100;
+      break;
+    case 1:
+      value = snapshot.memory * 100;
+      break;
+    case 2:
+      value = snapshot.running_processes;
+      break;
+    default:
+      value = pressure;
+      break;
+    }
+    Observe(r, system[r], "system", value, now);
+  }
+}
+
+void Alerts::ObserveProcesses(vector<Process> const &list, double now) {
+  char entity[64];
+  for (size_t r = 0; r < rules.size(); ++r) {
+    if (rules[r].scope != kProcess_) {
+      continue;
+    }
+    for (Process const &process : list) {
+      double value{0.0};
+      switch (rules[r].metric) {
+      case 0:
+        value = process.getCpuUtilization() * 100;
+        break;
+      case 1:
+        value = process.Ram();
+        break;
+      default:
+        value = process.IoRate() / 1024;
+        break;
+      }
+      string_view comm = process.Comm();
+      std::snprintf(entity, sizeof(entity), "pid %d (%.*s)", process.Pid(),
+                    static_cast<int>(comm.size()), comm.data());
+      Observe(r, processes[r][process.Pid()], entity, value, now);
+    }
+    // Processes that exited resolve their alerts and drop their series
+    for (auto it = processes[r].begin(); it != processes[r].end();) {
+      if (it->second.seen < now) {
+        if (it->second.firing) {
+          Emit(rules[r], it->second.label, std::nan(""), false);
+        }
+        it = processes[r].erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+void Alerts::ObserveCgroups(vector<Cgroup> const &list, double now) {
+  for (size_t r = 0; r < rules.size(); ++r) {
+    if (rules[r].scope != kCgroup_) {
+      continue;
+    }
+    for (Cgroup const &cgroup : list) {
+      double value{0.0};
+      switch (rules[r].metric) {
+      case 0:
+        value = cgroup.getCpuUtilization() * 100;
+        break;
+      case 1:
+        value = cgroup.Memory();
+        break;
+      case 2:
+        value = cgroup.ReadRate() / 1024;
+        break;
+      default:
+        value = cgroup.WriteRate() / 1024;
+        break;
+      }
+      auto series = cgroups[r].find(cgroup.Path());
+      if (series == cgroups[r].end()) {
+        series = cgroups[r].emplace(string(cgroup.Path()), Series{}).first;
+      }
+      Observe(r, series->second, cgroup.Path(), value, now);
+    }
+    for (auto it = cgroups[r].begin(); it != cgroups[r].end();) {
+      if (it->second.seen < now) {
+        if (it->second.firing) {
+          Emit(rules[r], it->first, std::nan(""), false);
+        }
+        it = cgroups[r].erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+void Alerts::Reset() {
+  for (size_t r = 0; r < rules.size(); ++r) {
+    system[r] = Series{};
+    processes[r].clear();
+    cgroups[r].clear();
+  }
+  firing.clear();
+}
+
+// Adds a sample and drops those that left the window, the min and max
+// deques only keep samples that can still become the extreme
+void Alerts::Series::Add(double now, double value, double window) {
+  samples.emplace_back(now, value);
+  sum += value;
+  while (!minima.empty() && minima.back().second >= value) {
+    minima.pop_back();
+  }
+  minima.emplace_back(now, value);
+  while (!maxima.empty() && maxima.back().second <= value) {
+    maxima.pop_back();
+  }
+  maxima.emplace_back(now, value);
+
+  const double oldest = now - window;
+  while (samples.front().first < oldest) {
+    sum -= samples.front().second;
+    samples.pop_front();
+  }
+  while (minima.front().first < oldest) {
+    minima.pop_front();
+  }
+  while (maxima.front().first < oldest) {
+    maxima.pop_front();
+  }
+}
+
+// Returns the aggregate over the window, NaN while a rate has seen less
+// than half of its window
+double Alerts::Series::Value(Aggregate aggregate, double window) const {
+  switch (aggregate) {
+  case kAvg_:
+    return sum / samples.size();
+  case kMin_:
+    return minima.front().second;
+  case kMax_:
+    return maxima.front().second;
+  case kRate_: {
+    const double span = samples.back().first - samples.front().first;
+    if (span < window / 2 || span <= 0) {
+      return std::nan("");
+    }
+    return (samples.back().second - samples.front().second) / span * 60;
+  }
+  case kLast_:
+  default:
+    return samples.back().second;
+  }
+}
+
+// Debounce: the condition has to hold for the rule's duration before the
+// alert fires. Hysteresis: it resolves only past the clear value.
+void Alerts::Observe(size_t r, Series &series, string_view entity,
+                     double value, double now) {
+  Rule const &rule = rules[r];
+  series.Add(now, value, rule.window);
+  series.seen = now;
+  const double aggregate = series.Value(rule.aggregate, rule.window);
+  if (std::isnan(aggregate)) {
+    return;
+  }
+  if (!series.firing) {
+    if (!Breach(rule, aggregate, rule.threshold)) {
+      series.pending_since = -1.0;
+      return;
+    }
+    if (series.pending_since < 0) {
+      series.pending_since = now;
+    }
+    if (now - series.pending_since >= rule.hold) {
+      series.firing = true;
+      series.label = entity;
+      Emit(rule, series.label, aggregate, true);
+    }
+  } else if (!Breach(rule, aggregate, rule.clear)) {
+    series.firing = false;
+    series.pending_since = -1.0;
+    Emit(rule, series.label, aggregate, false);
+  }
+}
+
+// Updates the firing list and writes the event to the log and the hook
+void Alerts::Emit(Rule const &rule, string_view entity, double value,
+                  bool fired) {
+  if (fired) {
+    firing.push_back(Active{&rule.name, string(entity), value});
+  } else {
+    for (auto it = firing.begin(); it != firing.end(); ++it) {
+      if (it->rule == &rule.name && it->entity == entity) {
+        firing.erase(it);
+        break;
+      }
+    }
+  }
+
+  const char *state = fired ? "FIRING" : "RESOLVED";
+  char value_text[32];
+  std::snprintf(value_text, sizeof(value_text), "%.2f", value);
+  if (log != nullptr) {
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S",
+                  std::localtime(&now));
+    std::fprintf(log, "%s %s %s %.*s value=%s rule=\"%s\"\n", stamp, state,
+                 rule.name.c_str(), static_cast<int>(entity.size()),
+                 entity.data(), value_text, rule.text.c_str());
+    std::fflush(log);
+  }
+
+  if (!hook.empty()) {
+    for (auto it = hooks.begin(); it != hooks.end();) {
+      it = waitpid(*it, nullptr, WNOHANG) == *it ? hooks.erase(it) : it + 1;
+    }
+    vector<string> variables = {"ALERT_RULE=" + rule.name,
+                                "ALERT_ENTITY=" + string(entity),
+                                string("ALERT_VALUE=") + value_text,
+                                string("ALERT_STATE=") + state};
+    vector<char *> envp;
+    for (char **variable = environ; *variable != nullptr; ++variable) {
+      envp.push_back(*variable);
+    }
+    for (string &variable : variables) {
+      envp.push_back(&variable[0]);
+    }
+    envp.push_back(nullptr);
+    char shell[] = "sh";
+    char flag[] = "-c";
+    char *argv[] = {shell, flag, &hook[0], nullptr};
+    pid_t pid;
+    if (posix_spawn(&pid, "/bin/sh", nullptr, nullptr, argv, envp.data()) ==
+        0) {
+      hooks.push_back(pid);
+    }
+  }
+}
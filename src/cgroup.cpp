@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <utility>
+
+#include "cgroup.h"
+#include "linux_parser.h"
+
+using std::string_view;
+
+namespace {
+// Writes <cgroup root><path>/<file> into buffer
+void CgroupFile(char *buffer, int size, string_view path, const char *file) {
+  std::snprintf(buffer, size, "%s%.*s/%s",
+                LinuxParser::CgroupRoot().c_str(),
+                static_cast<int>(path.size()), path.data(), file);
+}
+} // namespace
+
+Cgroup::Cgroup(string_view path) : path(path) {}
+
+Cgroup::~Cgroup() { Close(); }
+
+Cgroup::Cgroup(Cgroup &&other) noexcept { *this = std::move(other); }
+
+Cgroup &Cgroup::operator=(Cgroup &&other) noexcept {
+  if (this != &other) {
+    Close();
+    path = other.path;
+    processes = other.processes;
+    usage_usec = other.usage_usec;
+    read_bytes = other.read_bytes;
+    write_bytes = other.write_bytes;
+    prev_now = other.prev_now;
+    cpu_utilization = other.cpu_utilization;
+    memory = other.memory;
+    read_rate = other.read_rate;
+    write_rate = other.write_rate;
+    cpu_fd = std::exchange(other.cpu_fd, -1);
+    memory_fd = std::exchange(other.memory_fd, -1);
+    io_fd = std::exchange(other.io_fd, -1);
+  }
+  return *this;
+}
+
+// Return the path of the group below the cgroup root
+string_view Cgroup::Path() const { return path; }
+
+// Return the number of processes seen in the group by the last scan
+int Cgroup::Processes() const { return processes; }
+
+// Return the CPU utilization of the whole group
+float Cgroup::getCpuUtilization() const { return cpu_utilization; }
+
+// Return the memory charged to the group (in MB), -1 without memory control
+long Cgroup::Memory() const { return memory; }
+
+// Return the bytes per second read by the group
+float Cgroup::ReadRate() const { return read_rate; }
+
+// Return the bytes per second written by the group
+float Cgroup::WriteRate() const { return write_rate; }
+
+void Cgroup::SetPath(string_view path) { this->path = path; }
+
+void Cgroup::SetProcesses(int count) { processes = count; }
+
+// Rereads the group's counters, rates cover the time since the last update
+void Cgroup::Update(double now) {
+  char file[512];
+  char buffer[4096];
+  const double elapsed = prev_now > 0.0 ? now - prev_now : 0.0;
+  prev_now = now;
+
+  // cpu.stat: usage_usec <n> ...
+  CgroupFile(file, sizeof(file), path, "cpu.stat");
+  if (LinuxParser::ReadFile(cpu_fd, file, buffer, sizeof(buffer)) > 0) {
+    const char *found = std::strstr(buffer, "usage_usec ");
+    if (found != nullptr) {
+      long usage = std::strtol(found + 11, nullptr, 10);
+      if (usage_usec != -1 && elapsed > 0.0) {
+        cpu_utilization = (usage - usage_usec) / 1e6 / elapsed;
+      }
+      usage_usec = usage;
+    }
+  }
+
+  // memory.current: <bytes>
+  CgroupFile(file, sizeof(file), path, "memory.current");
+  if (LinuxParser::ReadFile(memory_fd, file, buffer, sizeof(buffer)) > 0) {
+    memory = std::strtol(buffer, nullptr, 10) / (1024 * 1024);
+  }
+
+  // io.stat: <major>:<minor> rbytes=<n> wbytes=<n> ... per device
+  CgroupFile(file, sizeof(file), path, "io.stat");
+  buffer[0] = '\0';
+  if (LinuxParser::ReadFile(io_fd, file, buffer, sizeof(buffer)) >= 0 &&
+      io_fd >= 0) {
+    long read{0}, written{0};
+    for (const char *found = buffer;
+         (found = std::strstr(found, "rbytes=")) != nullptr; found += 7) {
+      read += std::strtol(found + 7, nullptr, 10);
+    }
+    for (const char *found = buffer;
+         (found = std::strstr(found, "wbytes=")) != nullptr; found += 7) {
+      written += std::strtol(found + 7, nullptr, 10);
+    }
+    if (read_bytes != -1 && elapsed > 0.0) {
+      read_rate = (read - read_bytes) / elapsed;
+      write_rate = (written - write_bytes) / elapsed;
+    }
+    read_bytes = read;
+    write_bytes = written;
+  }
+}
+
+// Overload the "less than" comparison operator for Cgroup objects
+bool Cgroup::operator<(Cgroup const &a) const {
+  return getCpuUtilization() < a.getCpuUtilization();
+}
+
+void Cgroup::Close() {
+  for (int *fd : {&cpu_fd, &memory_fd, &io_fd}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+}
@@ -0,0 +1,239 @@
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "exporter.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+// Appends a formatted line to out without a temporary string
+template <typename... Args>
+void Append(string &out, const char *format, Args... args) {
+  char line[256];
+  int length = std::snprintf(line, sizeof(line), format, args...);
+  out.append(line, std::min<int>(length, sizeof(line) - 1));
+}
+
+// Appends a label value escaped as OpenMetrics requires
+void AppendEscaped(string &out, string_view value) {
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+}
+
+// Appends the labels identifying a process
+void AppendLabels(string &out, Process const &process) {
+  Append(out, "{pid=\"%d\",user=\"", process.Pid());
+  AppendEscaped(out, process.User());
+  out += "\",comm=\"";
+  AppendEscaped(out, process.Comm());
+  out += "\"}";
+}
+
+// Waits for events on fd, false once deadline passes first
+bool Ready(int fd, short events,
+           std::chrono::steady_clock::time_point deadline) {
+  while (true) {
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0) {
+      return false;
+    }
+    pollfd ready{fd, events, 0};
+    const int result = poll(&ready, 1, left.count());
+    if (result > 0) {
+      return true;
+    }
+    if (result == 0 || errno != EINTR) {
+      return false;
+    }
+  }
+}
+} // namespace
+
+// Listens on 127.0.0.1:port (0 picks a free port), throws on failure
+Exporter::Exporter(int port) {
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    throw std::runtime_error(string("socket: ") + std::strerror(errno));
+  }
+  int on{1};
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&address), length) != 0 ||
+      listen(listen_fd_, 16) != 0 ||
+      getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&address),
+                  &length) != 0 ||
+      pipe2(wake_fds_, O_CLOEXEC) != 0) {
+    string error = std::strerror(errno);
+    close(listen_fd_);
+    throw std::runtime_error("listen on port " + std::to_string(port) + ": " +
+                             error);
+  }
+  port_ = ntohs(address.sin_port);
+  front_ = std::make_shared<string>(
+      "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n"
+      "Connection: close\r\n\r\n");
+  thread_ = std::thread(&Exporter::Serve, this);
+}
+
+Exporter::~Exporter() {
+  if (write(wake_fds_[1], "x", 1) == 1) {
+    thread_.join();
+  } else {
+    thread_.detach();
+  }
+  close(wake_fds_[0]);
+  close(wake_fds_[1]);
+  close(listen_fd_);
+}
+
+// Return the port listened on
+int Exporter::Port() const { return port_; }
+
+// Serializes a sample, later scrapes serve it until the next Publish()
+void Exporter::Publish(System &system, std::vector<Process> const &processes) {
+  body_.clear();
+  Append(body_, "# TYPE monitor_cpu_utilization gauge\n"
+                "# HELP monitor_cpu_utilization Share of CPU time not idle.\n"
+                "monitor_cpu_utilization %.4f\n",
+         system.Cpu().LastUtilization());
+  Append(body_,
+         "# TYPE monitor_memory_utilization gauge\n"
+         "# HELP monitor_memory_utilization Share of memory not available.\n"
+         "monitor_memory_utilization %.4f\n",
+         system.MemoryUtilization());
+  Append(body_, "# TYPE monitor_uptime_seconds gauge\n"
+                "monitor_uptime_seconds %ld\n",
+         system.UpTime());
+  Append(body_, "# TYPE monitor_forks counter\n"
+                "# HELP monitor_forks Processes created since boot.\n"
+                "monitor_forks_total %d\n",
+         system.TotalProcesses());
+  Append(body_, "# TYPE monitor_processes_running gauge\n"
+                "monitor_processes_running %d\n",
+         system.RunningProcesses());
+
+  body_ += "# TYPE monitor_process_cpu_utilization gauge\n";
+  for (Process const &process : processes) {
+    body_ += "monitor_process_cpu_utilization";
+    AppendLabels(body_, process);
+    Append(body_, " %.4f\n", process.getCpuUtilization());
+  }
+  body_ += "# TYPE monitor_process_memory_bytes gauge\n"
+           "# UNIT monitor_process_memory_bytes bytes\n"
+           "# HELP monitor_process_memory_bytes Resident set size.\n";
+  for (Process const &process : processes) {
+    body_ += "monitor_process_memory_bytes";
+    AppendLabels(body_, process);
+    Append(body_, " %ld\n", process.Resident() * 1024);
+  }
+  body_ += "# EOF\n";
+
+  if (!back_ || back_.use_count() != 1) {
+    back_ = std::make_shared<string>();
+  }
+  back_->clear();
+  Append(*back_,
+         "HTTP/1.1 200 OK\r\n"
+         "Content-Type: application/openmetrics-text; version=1.0.0; "
+         "charset=utf-8\r\n"
+         "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+         body_.size());
+  *back_ += body_;
+  std::lock_guard<std::mutex> lock(mutex_);
+  front_.swap(back_);
+}
+
+// Accepts and answers connections until the destructor wakes it up
+void Exporter::Serve() {
+  pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+    int client =
+        accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (client < 0) {
+      continue;
+    }
+    Respond(client);
+    close(client);
+  }
+}
+
+// Answers one request, GET /metrics gets the last snapshot. The whole
+// exchange has kRequestTimeoutMs, however slowly the client trickles.
+void Exporter::Respond(int client) {
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(kRequestTimeoutMs);
+  char request[2048];
+  int length{0};
+  ssize_t n;
+  while (length < static_cast<int>(sizeof(request)) - 1 &&
+         Ready(client, POLLIN, deadline) &&
+         (n = read(client, request + length, sizeof(request) - 1 - length)) >
+             0) {
+    length += n;
+    request[length] = '\0';
+    if (std::strstr(request, "\r\n\r\n") != nullptr) {
+      break;
+    }
+  }
+  request[length] = '\0';
+
+  if (std::strncmp(request, "GET /metrics ", 13) != 0) {
+    static const char kNotFound[] = "HTTP/1.1 404 Not Found\r\n"
+                                    "Content-Length: 0\r\n"
+                                    "Connection: close\r\n\r\n";
+    send(client, kNotFound, sizeof(kNotFound) - 1, MSG_NOSIGNAL);
+    return;
+  }
+  std::shared_ptr<const string> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot = front_;
+  }
+  for (size_t sent = 0; sent < snapshot->size();) {
+    if (!Ready(client, POLLOUT, deadline)) {
+      return;
+    }
+    n = send(client, snapshot->data() + sent, snapshot->size() - sent,
+             MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    sent += n;
+  }
+}
@@ -0,0 +1,233 @@
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "filter.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+// Operators, two character ones first so that "<=" is not read as "<"
+const std::pair<const char *, int> kOperators[] = {
+    {"!=", 1}, {"!~", 7}, {"<=", 3}, {">=", 5},
+    {"=", 0},  {"<", 2},  {">", 4},  {"~", 6}};
+} // namespace
+
+// Compiles an expression, throws std::invalid_argument if it is malformed
+Filter::Filter(string const &expression) : text(expression) {
+  std::istringstream terms_stream(expression);
+  string word;
+  while (terms_stream >> word) {
+    size_t at = word.find_first_of("=!<>~");
+    if (at == string::npos || at == 0) {
+      throw std::invalid_argument("expected <field><op><value> in '" + word +
+                                  "'");
+    }
+    Term term{};
+    string op;
+    for (auto const &candidate : kOperators) {
+      if (word.compare(at, std::strlen(candidate.first), candidate.first) ==
+          0) {
+        op = candidate.first;
+        term.op = static_cast<Op>(candidate.second);
+        break;
+      }
+    }
+    if (op.empty()) {
+      throw std::invalid_argument("unknown operator in '" + word + "'");
+    }
+    const string field = word.substr(0, at);
+    term.text = word.substr(at + op.size());
+
+    Stage stage;
+    bool numeric{true};
+    if (field == "pid") {
+      term.field = kPidField_;
+      stage = kPid_;
+    } else if (field == "uid" || field == "user") {
+      term.field = kUid_;
+      stage = kStatus_;
+      if (field == "user") {
+        // Resolve the name once instead of per process
+        if (term.op != kEq_ && term.op != kNe_) {
+          throw std::invalid_argument("user only supports = and !=");
+        }
+        bool known{false};
+        for (auto const &user : LinuxParser::Users()) {
+          if (user.second == term.text) {
+            term.text = std::to_string(user.first);
+            known = true;
+            break;
+          }
+        }
+        if (!known) {
+          throw std::invalid_argument("unknown user '" + term.text + "'");
+        }
+      }
+    } else if (field == "ppid") {
+      term.field = kPpid_;
+      stage = kStat_;
+    } else if (field == "comm") {
+      term.field = kComm_;
+      stage = kStat_;
+      numeric = false;
+    } else if (field == "state") {
+      term.field = kState_;
+      stage = kStat_;
+      numeric = false;
+    } else if (field == "ram") {
+      term.field = kRam_;
+      stage = kStatus_;
+    } else if (field == "cpu") {
+      term.field = kCpu_;
+      stage = kProcess_;
+    } else if (field == "cmd") {
+      term.field = kCmd_;
+      stage = kProcess_;
+      numeric = false;
+    } else if (field == "cgroup") {
+      term.field = kCgroup_;
+      stage = kProcess_;
+      numeric = false;
+    } else {
+      throw std::invalid_argument("unknown field '" + field + "'");
+    }
+
+    if (term.op == kMatch_ || term.op == kNoMatch_) {
+      if (numeric) {
+        throw std::invalid_argument("~ needs a text field in '" + word + "'");
+      }
+      try {
+        term.regex = std::regex(term.text, std::regex::optimize);
+      } catch (std::regex_error const &) {
+        throw std::invalid_argument("bad regular expression '" + term.text +
+                                    "'");
+      }
+    } else if (!numeric && term.op != kEq_ && term.op != kNe_) {
+      throw std::invalid_argument("text fields are not ordered in '" + word +
+                                  "'");
+    } else if (numeric) {
+      char *end;
+      term.number = std::strtod(term.text.c_str(), &end);
+      if (term.text.empty() || *end != '\0') {
+        throw std::invalid_argument("expected a number in '" + word + "'");
+      }
+    }
+    terms[stage].push_back(std::move(term));
+  }
+}
+
+// Return the expression the filter was compiled from
+const string &Filter::Text() const { return text; }
+
+// Return whether any term needs the data of a stage
+bool Filter::Has(Stage stage) const { return !terms[stage].empty(); }
+
+// Matches the terms that only need the pid
+bool Filter::Matches(int pid) const {
+  for (Term const &term : terms[kPid_]) {
+    if (!Compare(term, pid)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Matches the terms on /proc/<pid>/stat fields
+bool Filter::Matches(LinuxParser::ProcessStat const &stat) const {
+  for (Term const &term : terms[kStat_]) {
+    bool match{false};
+    switch (term.field) {
+    case kPpid_:
+      match = Compare(term, stat.ppid);
+      break;
+    case kComm_:
+      match = Compare(term, string_view(stat.comm));
+      break;
+    case kState_:
+      match = Compare(term, string_view(&stat.state, 1));
+      break;
+    default:
+      break;
+    }
+    if (!match) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Matches the terms on /proc/<pid>/status fields
+bool Filter::Matches(LinuxParser::ProcessStatus const &status) const {
+  for (Term const &term : terms[kStatus_]) {
+    // Same uid as the USER column, same unit as Process::Ram()
+    if (!Compare(term, term.field == kUid_ ? status.uid
+                                           : status.vm_rss / 1024)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Matches the terms on the updated process record
+bool Filter::Matches(Process const &process) const {
+  for (Term const &term : terms[kProcess_]) {
+    bool match{false};
+    switch (term.field) {
+    case kCpu_:
+      match = Compare(term, process.getCpuUtilization() * 100);
+      break;
+    case kCmd_:
+      match = Compare(term, process.Command());
+      break;
+    case kCgroup_:
+      match = Compare(term, process.Cgroup());
+      break;
+    default:
+      break;
+    }
+    if (!match) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Filter::Compare(Term const &term, double value) {
+  switch (term.op) {
+  case kEq_:
+    return value == term.number;
+  case kNe_:
+    return value != term.number;
+  case kLt_:
+    return value < term.number;
+  case kLe_:
+    return value <= term.number;
+  case kGt_:
+    return value > term.number;
+  case kGe_:
+    return value >= term.number;
+  default:
+    return false;
+  }
+}
+
+bool Filter::Compare(Term const &term, string_view value) {
+  switch (term.op) {
+  case kEq_:
+    return value == term.text;
+  case kNe_:
+    return value != term.text;
+  case kMatch_:
+    return std::regex_search(value.begin(), value.end(), term.regex);
+  case kNoMatch_:
+    return !std::regex_search(value.begin(), value.end(), term.regex);
+  default:
+    // Text fields are not ordered
+    return false;
+  }
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+
+#include "histogram.h"
+
+// Records one value, negative values count as zero
+void Histogram::Add(long value) {
+  value = std::max(0L, value);
+  ++counts[Bucket(value)];
+  ++count;
+  max = std::max(max, value);
+}
+
+// Adds the values recorded by another histogram
+void Histogram::Merge(Histogram const &other) {
+  for (int i = 0; i < kBuckets; ++i) {
+    counts[i] += other.counts[i];
+  }
+  count += other.count;
+  max = std::max(max, other.max);
+}
+
+// Returns the p-th percentile (0..1), the upper bound of its bucket
+long Histogram::Percentile(double p) const {
+  if (count == 0) {
+    return 0;
+  }
+  const uint64_t rank = std::max<uint64_t>(1, p * count + 0.5);
+  uint64_t seen{0};
+  for (int i = 0; i < kBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return std::min(Value(i), max);
+    }
+  }
+  return max;
+}
+
+// Returns the number of values recorded
+long Histogram::Count() const { return count; }
+
+// Returns the largest value recorded
+long Histogram::Max() const { return max; }
+
+// Values below 16 get a bucket each, above that 16 buckets per power of two
+int Histogram::Bucket(long value) {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  const int exponent = 63 - __builtin_clzl(value);
+  const int sub = (value >> (exponent - 4)) & (kSubBuckets - 1);
+  return (exponent - 3) * kSubBuckets + sub;
+}
+
+// Returns the largest value falling into a bucket
+long Histogram::Value(int bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  const int exponent = bucket / kSubBuckets + 3;
+  const long sub = bucket % kSubBuckets;
+  return ((kSubBuckets + sub + 1) << (exponent - 4)) - 1;
+}
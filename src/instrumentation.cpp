@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <new>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "instrumentation.h"
+
+using std::string;
+
+namespace {
+// Number of samples kept per stage for percentiles
+constexpr int kWindow{512};
+
+struct StageStats {
+  std::array<long, kWindow> samples{};
+  int next{0};
+  int count{0};
+  long syscalls{0};
+  long allocations{0};
+};
+
+std::array<StageStats, Instrumentation::kStageCount_> stats;
+std::atomic<long> allocations{0};
+
+// Persistent descriptors so that sampling costs a single pread each
+int io_fd{-1};
+int statm_fd{-1};
+
+// Previous self sample
+long prev_cpu_us{-1};
+long prev_wall_us{-1};
+float self_cpu{0.0};
+long self_rss{0};
+
+// Reads a /proc file of ours through a kept-open descriptor
+int ReadSelf(int &fd, const char *path, char *buffer, int size) {
+  if (fd < 0) {
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return 0;
+    }
+  }
+  ssize_t n = pread(fd, buffer, size - 1, 0);
+  if (n < 0) {
+    return 0;
+  }
+  buffer[n] = '\0';
+  return n;
+}
+
+long NowMicroseconds() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+// Count every heap allocation the monitor makes
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+Instrumentation::ScopedTimer::ScopedTimer(Stage stage)
+    : stage(stage), syscalls(Syscalls()), allocations(Allocations()),
+      start(std::chrono::steady_clock::now()) {}
+
+Instrumentation::ScopedTimer::~ScopedTimer() {
+  const long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  StageStats &s = stats[stage];
+  s.samples[s.next] = elapsed;
+  s.next = (s.next + 1) % kWindow;
+  s.count = std::min(s.count + 1, kWindow);
+  // Do not charge the stage for the pread that opened the measurement
+  s.syscalls = std::max(0L, Syscalls() - syscalls - 1);
+  s.allocations = Allocations() - allocations;
+}
+
+// Returns the display name of a stage
+const char *Instrumentation::StageName(Stage stage) {
+  switch (stage) {
+  case kScan_:
+    return "scan";
+  case kParse_:
+    return "parse";
+  case kDetail_:
+    return "detail";
+  case kSort_:
+    return "sort";
+  case kRender_:
+    return "render";
+  default:
+    return "?";
+  }
+}
+
+// Returns the p-th percentile (0..1) of the stage duration in nanoseconds
+long Instrumentation::Percentile(Stage stage, float p) {
+  const StageStats &s = stats[stage];
+  if (s.count == 0) {
+    return 0;
+  }
+  std::array<long, kWindow> sorted;
+  std::copy(s.samples.begin(), s.samples.begin() + s.count, sorted.begin());
+  int rank = std::min(s.count - 1, static_cast<int>(p * s.count));
+  std::nth_element(sorted.begin(), sorted.begin() + rank,
+                   sorted.begin() + s.count);
+  return sorted[rank];
+}
+
+// Returns the read/write syscalls made by the last run of a stage
+long Instrumentation::LastSyscalls(Stage stage) {
+  return stats[stage].syscalls;
+}
+
+// Returns the heap allocations made by the last run of a stage
+long Instrumentation::LastAllocations(Stage stage) {
+  return stats[stage].allocations;
+}
+
+// Returns the read and write syscalls made so far by the monitor
+long Instrumentation::Syscalls() {
+  char buffer[256];
+  if (ReadSelf(io_fd, "/proc/self/io", buffer, sizeof(buffer)) == 0) {
+    return 0;
+  }
+  long syscr{0}, syscw{0};
+  const char *r = std::strstr(buffer, "syscr:");
+  const char *w = std::strstr(buffer, "syscw:");
+  if (r != nullptr) {
+    syscr = std::strtol(r + 6, nullptr, 10);
+  }
+  if (w != nullptr) {
+    syscw = std::strtol(w + 6, nullptr, 10);
+  }
+  return syscr + syscw;
+}
+
+// Returns the heap allocations made so far by the monitor
+long Instrumentation::Allocations() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+// Samples the CPU time and resident memory of the monitor
+void Instrumentation::SampleSelf() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  const long cpu_us =
+      (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L +
+      usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+  const long wall_us = NowMicroseconds();
+  if (prev_wall_us != -1 && wall_us > prev_wall_us) {
+    self_cpu = static_cast<float>(cpu_us - prev_cpu_us) /
+               static_cast<float>(wall_us - prev_wall_us);
+  }
+  prev_cpu_us = cpu_us;
+  prev_wall_us = wall_us;
+
+  // statm: size resident shared ... (in pages)
+  char buffer[128];
+  if (ReadSelf(statm_fd, "/proc/self/statm", buffer, sizeof(buffer)) > 0) {
+    long size{0}, resident{0};
+    if (std::sscanf(buffer, "%ld %ld", &size, &resident) == 2) {
+      self_rss = resident * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+  }
+}
+
+// Returns the CPU utilization of the monitor since the previous sample
+float Instrumentation::SelfCpuUtilization() { return self_cpu; }
+
+// Returns the resident memory of the monitor in kB
+long Instrumentation::SelfRss() { return self_rss; }
+
+// Writes all statistics to a file
+bool Instrumentation::Dump(const string &path) {
+  std::ofstream out(path);
+  if (!out.is_open()) {
+    return false;
+  }
+  out << "stage p50_us p99_us samples last_syscalls last_allocations\n";
+  for (int i = 0; i < kStageCount_; ++i) {
+    Stage stage = static_cast<Stage>(i);
+    out << StageName(stage) << " " << Percentile(stage, 0.5) / 1000 << " "
+        << Percentile(stage, 0.99) / 1000 << " " << stats[i].count << " "
+        << LastSyscalls(stage) << " " << LastAllocations(stage) << "\n";
+  }
+  out << "self_cpu_percent " << SelfCpuUtilization() * 100 << "\n";
+  out << "self_rss_kb " << SelfRss() << "\n";
+  out << "total_syscalls " << Syscalls() << "\n";
+  out << "total_allocations " << Allocations() << "\n";
+  return true;
+}
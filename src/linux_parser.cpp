@@ -1,25 +1,80 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sstream>
 #include <string>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <vector>
 
 #include "linux_parser.h"
 
-using std::stof;
 using std::string;
-using std::to_string;
 using std::vector;
 
-// Splits string by space to vector of strings
-vector<string> splitString(string s) {
-  std::stringstream stringstream(s);
-  std::string split;
-  vector<string> result;
+namespace {
+// Kept-open descriptors of the system-wide files read every refresh
+int stat_fd{-1};
+int meminfo_fd{-1};
+int uptime_fd{-1};
+int pressure_fd{-1};
 
-  while (stringstream >> split) {
-    result.push_back(split);
+// Returns the number following key in buffer, or fallback if absent
+long ValueOf(const char *buffer, const char *key, long fallback = 0) {
+  const char *found = std::strstr(buffer, key);
+  if (found == nullptr) {
+    return fallback;
   }
-  return result;
+  return std::strtol(found + std::strlen(key), nullptr, 10);
+}
+
+// Writes /proc/<pid><file> into path
+void ProcPath(char *path, int size, int pid, const string &file) {
+  std::snprintf(path, size, "%s%d%s", LinuxParser::kProcDirectory.c_str(),
+                pid, file.c_str());
+}
+} // namespace
+
+// Reads a whole file into buffer, returns the number of bytes read
+int LinuxParser::ReadFile(const char *path, char *buffer, int size) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return 0;
+  }
+  int total{0};
+  ssize_t n;
+  while (total < size - 1 &&
+         (n = read(fd, buffer + total, size - 1 - total)) > 0) {
+    total += n;
+  }
+  close(fd);
+  buffer[total] = '\0';
+  return total;
+}
+
+// Rereads a file through a kept-open descriptor (opened on first use)
+int LinuxParser::ReadFile(int &fd, const char *path, char *buffer, int size) {
+  if (fd == kAbsentFd) {
+    return 0;
+  }
+  if (fd < 0) {
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      // A missing file stays missing, other errors are retried
+      fd = errno == ENOENT ? kAbsentFd : -1;
+      return 0;
+    }
+  }
+  ssize_t n = pread(fd, buffer, size - 1, 0);
+  if (n < 0) {
+    return 0;
+  }
+  buffer[n] = '\0';
+  return n;
 }
 
 // Reads in data about the OS
@@ -63,42 +118,45 @@ string LinuxParser::Kernel() {
 }
 
 // Reads in all pids of running tasks from filesystem
-vector<int> LinuxParser::Pids() {
-  vector<int> pids;
-  DIR *directory = opendir(kProcDirectory.c_str());
-  struct dirent *file;
-  while ((file = readdir(directory)) != nullptr) {
-    // Is this a directory?
-    if (file->d_type == DT_DIR) {
-      // Is every character of the name a digit?
-      string filename(file->d_name);
-      if (std::all_of(filename.begin(), filename.end(), isdigit)) {
-        int pid = stoi(filename);
+void LinuxParser::Pids(vector<int> &pids) {
+  pids.clear();
+  int fd = open(kProcDirectory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  // getdents64 straight into a stack buffer, readdir would malloc one
+  alignas(8) char buffer[32768];
+  long n;
+  while ((n = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+    for (long offset = 0; offset < n;) {
+      auto *entry = reinterpret_cast<struct dirent64 *>(buffer + offset);
+      offset += entry->d_reclen;
+      // Is this a directory whose name is all digits?
+      if (entry->d_type != DT_DIR) {
+        continue;
+      }
+      const char *name = entry->d_name;
+      int pid{0};
+      for (; *name >= '0' && *name <= '9'; ++name) {
+        pid = pid * 10 + (*name - '0');
+      }
+      if (*name == '\0' && name != entry->d_name) {
         pids.push_back(pid);
       }
     }
   }
-  closedir(directory);
-  return pids;
+  close(fd);
 }
 
 // Reads and returns the system memory utilization
 float LinuxParser::MemoryUtilization() {
-  float total_mem, available_mem;
-  string line, key, value;
-  std::ifstream filestream(kProcDirectory + kMeminfoFilename);
-  if (filestream.is_open()) {
-    while (std::getline(filestream, line)) {
-      std::istringstream linestream(line);
-      while (linestream >> key >> value) {
-        if (key == "MemTotal:") {
-          total_mem = std::stof(value);
-        } else if (key == "MemAvailable:") {
-          available_mem = std::stof(value);
-        }
-      }
-    }
+  char buffer[4096];
+  if (ReadFile(meminfo_fd, (kProcDirectory + kMeminfoFilename).c_str(),
+               buffer, sizeof(buffer)) == 0) {
+    return 0.0;
   }
+  const float total_mem = ValueOf(buffer, "MemTotal:");
+  const float available_mem = ValueOf(buffer, "MemAvailable:");
   if (total_mem == 0.0) {
     return 0.0;
   }
@@ -107,183 +165,223 @@ float LinuxParser::MemoryUtilization() {
 
 // Reads and returns the system uptime
 long LinuxParser::UpTime() {
-  string uptime;
-  string line;
-  std::ifstream stream(kProcDirectory + kUptimeFilename);
-  if (stream.is_open()) {
-    std::getline(stream, line);
-    std::istringstream linestream(line);
-    linestream >> uptime;
+  char buffer[128];
+  if (ReadFile(uptime_fd, (kProcDirectory + kUptimeFilename).c_str(), buffer,
+               sizeof(buffer)) == 0) {
+    return 0;
   }
-  return std::stol(uptime);
+  return std::strtol(buffer, nullptr, 10);
 }
 
 // Reads and returns CPU utilization
-vector<string> LinuxParser::CpuUtilization() {
-  string line;
-  string key;
-  string usertime, nicetime, systemtime, idletime, iowait, irq, softirq, steal;
-  std::ifstream filestream(kProcDirectory + kStatFilename);
-  if (filestream.is_open()) {
-    while (std::getline(filestream, line)) {
-      std::istringstream linestream(line);
-      while (linestream >> key >> usertime >> nicetime >> systemtime >>
-             idletime >> iowait >> irq >> softirq >> steal) {
-        if (key == "cpu") {
-          return {usertime, nicetime, systemtime, idletime,
-                  iowait,   irq,      softirq,    steal};
-        }
-      }
-    }
+std::array<long, LinuxParser::kGuest_> LinuxParser::CpuUtilization() {
+  std::array<long, kGuest_> jiffies{};
+  char buffer[512];
+  if (ReadFile(stat_fd, (kProcDirectory + kStatFilename).c_str(), buffer,
+               sizeof(buffer)) == 0) {
+    return jiffies;
+  }
+  // The first line is the aggregate "cpu" line
+  char *cursor = buffer + 3;
+  for (long &value : jiffies) {
+    value = std::strtol(cursor, &cursor, 10);
   }
-  return {};
+  return jiffies;
+}
+
+// Reads and returns the CPU pressure stall (some avg10, in %)
+float LinuxParser::CpuPressure() {
+  char buffer[256];
+  if (ReadFile(pressure_fd, (kProcDirectory + kCpuPressureFilename).c_str(),
+               buffer, sizeof(buffer)) == 0) {
+    return 0.0;
+  }
+  // some avg10=<value> avg60=<value> ...
+  const char *found = std::strstr(buffer, "some avg10=");
+  if (found == nullptr) {
+    return 0.0;
+  }
+  return std::strtof(found + 11, nullptr);
 }
 
 // Reads and returns the total number of processes
 int LinuxParser::TotalProcesses() {
-  string line;
-  string key;
-  string value;
-  std::ifstream filestream(kProcDirectory + kStatFilename);
-  if (filestream.is_open()) {
-    while (std::getline(filestream, line)) {
-      std::istringstream linestream(line);
-      while (linestream >> key >> value) {
-        if (key == "processes") {
-          return std::stoi(value);
-        }
-      }
-    }
+  // /proc/stat grows with the number of cpus
+  char buffer[65536];
+  if (ReadFile(stat_fd, (kProcDirectory + kStatFilename).c_str(), buffer,
+               sizeof(buffer)) == 0) {
+    return 0;
   }
-  return 0;
+  return ValueOf(buffer, "\nprocesses ");
 }
 
 // Reads and returns the number of running processes
 int LinuxParser::RunningProcesses() {
+  char buffer[65536];
+  if (ReadFile(stat_fd, (kProcDirectory + kStatFilename).c_str(), buffer,
+               sizeof(buffer)) == 0) {
+    return 0;
+  }
+  return ValueOf(buffer, "\nprocs_running ");
+}
+
+// Reads and returns all (uid, name) pairs of the password file
+vector<std::pair<int, string>> LinuxParser::Users() {
+  vector<std::pair<int, string>> users;
   string line;
-  string key;
+  string name;
   string value;
-  std::ifstream filestream(kProcDirectory + kStatFilename);
+  string x;
+  std::ifstream filestream(kPasswordPath);
   if (filestream.is_open()) {
     while (std::getline(filestream, line)) {
+      std::replace(line.begin(), line.end(), ':', ' ');
       std::istringstream linestream(line);
-      while (linestream >> key >> value) {
-        if (key == "procs_running") {
-          return std::stoi(value);
-        }
+      if (linestream >> name >> x >> value) {
+        users.emplace_back(std::atoi(value.c_str()), name);
       }
     }
   }
-  return 0;
+  return users;
 }
 
-// Reads and returns the command associated with a process
-string LinuxParser::Command(int pid) {
-  string command;
-  string line;
-  std::ifstream stream(kProcDirectory + std::to_string(pid) + kCmdlineFilename);
-  if (stream.is_open()) {
-    std::getline(stream, line);
-    std::istringstream linestream(line);
-    linestream >> command;
-    return command;
-  }
-  return "None";
+// Reads the fields of /proc/<pid>/stat, returns false if the process is gone
+bool LinuxParser::ReadProcessStat(int pid, ProcessStat &stat) {
+  char path[64];
+  char buffer[1024];
+  ProcPath(path, sizeof(path), pid, kStatFilename);
+  return ReadFile(path, buffer, sizeof(buffer)) != 0 &&
+         ParseProcessStat(buffer, stat);
 }
 
-// Reads and returns the memory used by a process
-string LinuxParser::Ram(int pid) {
-  string line;
-  string key;
-  string value;
-  std::ifstream filestream(kProcDirectory + std::to_string(pid) +
-                           kStatusFilename);
-  if (filestream.is_open()) {
-    while (std::getline(filestream, line)) {
-      std::istringstream linestream(line);
-      while (linestream >> key >> value) {
-        if (key == "VmSize:") {
-          // Return memory usage in MB
-          return std::to_string(int(std::stod(value) / 1000));
-        }
-      }
-    }
+// Parses the contents of /proc/<pid>/stat, returns false if malformed
+bool LinuxParser::ParseProcessStat(const char *buffer, ProcessStat &stat) {
+  // The command may contain spaces and parens, it ends at the last paren
+  const char *open_paren = std::strchr(buffer, '(');
+  const char *close_paren = std::strrchr(buffer, ')');
+  if (open_paren == nullptr || close_paren == nullptr) {
+    return false;
   }
-  return string();
+  int length = std::min<long>(close_paren - open_paren - 1,
+                              sizeof(stat.comm) - 1);
+  std::memcpy(stat.comm, open_paren + 1, length);
+  stat.comm[length] = '\0';
+
+  // Fields from 3 (state) on, counting from 1
+  char *cursor = const_cast<char *>(close_paren) + 2;
+  stat.state = *cursor++;
+  long fields[26];
+  for (int field = 4; field <= 26; ++field) {
+    fields[field - 1] = std::strtol(cursor, &cursor, 10);
+  }
+  stat.ppid = fields[3];
+  stat.utime = fields[13];
+  stat.stime = fields[14];
+  stat.cutime = fields[15];
+  stat.cstime = fields[16];
+  stat.nice = fields[18];
+  stat.starttime = fields[21];
+  stat.startcode = fields[25];
+  return true;
 }
 
-// Reads and returns the user ID associated with a process
-string LinuxParser::Uid(int pid) {
-  string line;
-  string key;
-  string value;
-  std::ifstream filestream(kProcDirectory + std::to_string(pid) +
-                           kStatusFilename);
-  if (filestream.is_open()) {
-    while (std::getline(filestream, line)) {
-      std::istringstream linestream(line);
-      while (linestream >> key >> value) {
-        if (key == "Uid:") {
-          return value;
-        }
-      }
-    }
+// Reads the fields of /proc/<pid>/status, returns false if the process is gone
+bool LinuxParser::ReadProcessStatus(int pid, ProcessStatus &status) {
+  char path[64];
+  char buffer[4096];
+  ProcPath(path, sizeof(path), pid, kStatusFilename);
+  if (ReadFile(path, buffer, sizeof(buffer)) == 0) {
+    return false;
   }
-  return string();
+  ParseProcessStatus(buffer, status);
+  return true;
 }
 
-// Reads and returns the user associated with a process
-string LinuxParser::User(int pid) {
-  // Get UID for given PID
-  string uid = Uid(pid);
+// Parses the contents of /proc/<pid>/status
+void LinuxParser::ParseProcessStatus(const char *buffer,
+                                     ProcessStatus &status) {
+  status.uid = ValueOf(buffer, "\nUid:", -1);
+  // Kernel threads have no Vm lines
+  status.vm_size = ValueOf(buffer, "\nVmSize:");
+  status.vm_rss = ValueOf(buffer, "\nVmRSS:");
+  status.vm_swap = ValueOf(buffer, "\nVmSwap:");
+  status.context_switches = ValueOf(buffer, "\nvoluntary_ctxt_switches:") +
+                            ValueOf(buffer, "\nnonvoluntary_ctxt_switches:");
+}
 
-  string line;
-  string name;
-  string value;
-  string x;
-  std::ifstream filestream(kPasswordPath);
-  if (filestream.is_open()) {
-    while (std::getline(filestream, line)) {
-      std::replace(line.begin(), line.end(), ':', ' ');
-      std::istringstream linestream(line);
-      // If UID of line equals UID from PID return name
-      while (linestream >> name >> x >> value) {
-        if (value == uid) {
-          return name;
-        }
-      }
-    }
+// Reads /proc/<pid>/smaps_rollup, which walks every mapping of the
+// process in the kernel, so only for a few processes per refresh
+bool LinuxParser::ReadProcessMemory(int pid, ProcessMemory &memory) {
+  char path[64];
+  char buffer[2048];
+  ProcPath(path, sizeof(path), pid, kSmapsRollupFilename);
+  if (ReadFile(path, buffer, sizeof(buffer)) == 0) {
+    return false;
   }
-  return string();
+  memory.rss = ValueOf(buffer, "\nRss:");
+  memory.pss = ValueOf(buffer, "\nPss:");
+  memory.swap = ValueOf(buffer, "\nSwap:");
+  memory.anonymous = ValueOf(buffer, "\nAnonymous:");
+  memory.file = memory.rss - memory.anonymous;
+  return true;
 }
 
-// Reads and returns the uptime of a process
-long LinuxParser::UpTime(int pid) {
-  string line;
-  std::ifstream filestream(kProcDirectory + std::to_string(pid) +
-                           kStatFilename);
-  if (filestream.is_open()) {
-    std::getline(filestream, line);
-    std::istringstream linestream(line);
-    vector<string> splitted = splitString(line);
-    return UpTime() - (std::stol(splitted[21]) / sysconf(_SC_CLK_TCK));
+// Parses the contents of /proc/<pid>/io, only readable by the owner (or
+// root), so a missing file leaves the counters at zero
+void LinuxParser::ParseProcessIo(const char *buffer, ProcessIo &io) {
+  io.read_bytes = ValueOf(buffer, "\nread_bytes:");
+  io.write_bytes = ValueOf(buffer, "\nwrite_bytes:");
+}
+
+// Reads the command line of a process with arguments separated by spaces
+int LinuxParser::ReadCommand(int pid, char *buffer, int size) {
+  char path[64];
+  ProcPath(path, sizeof(path), pid, kCmdlineFilename);
+  int length = ReadFile(path, buffer, size);
+  while (length > 0 && buffer[length - 1] == '\0') {
+    --length;
   }
-  return 0;
+  std::replace(buffer, buffer + length, '\0', ' ');
+  buffer[length] = '\0';
+  return length;
 }
 
-// Reads and returns CPU utilization of given PID
-vector<string> LinuxParser::ProcessCpuUtilization(int pid) {
-  string line;
-  string key;
-  string utime, stime, cutime, cstime, starttime;
-  std::ifstream filestream(kProcDirectory + std::to_string(pid) +
-                           kStatFilename);
-  if (filestream.is_open()) {
-    std::getline(filestream, line);
-    vector<string> splitted = splitString(line);
-    // utime, stime, cutime, cstime, starttime
-    return {splitted[13], splitted[14], splitted[15], splitted[16],
-            splitted[21]};
+// Reads the cgroup v2 path ("0::<path>") of a process, 0 if it has none
+int LinuxParser::ReadCgroup(int pid, char *buffer, int size) {
+  char path[64];
+  char contents[4096];
+  ProcPath(path, sizeof(path), pid, kCgroupFilename);
+  if (ReadFile(path, contents, sizeof(contents)) == 0) {
+    return 0;
   }
-  return {};
-}
\ No newline at end of file
+  const char *line = contents;
+  if (std::strncmp(line, "0::", 3) != 0) {
+    line = std::strstr(contents, "\n0::");
+    if (line == nullptr) {
+      return 0;
+    }
+    ++line;
+  }
+  line += 3;
+  int length = std::strcspn(line, "\n");
+  length = std::min(length, size - 1);
+  std::memcpy(buffer, line, length);
+  buffer[length] = '\0';
+  return length;
+}
+
+// Returns where the cgroup v2 hierarchy is mounted, empty if nowhere
+string const &LinuxParser::CgroupRoot() {
+  static const string root = [] {
+    // Pure v2 mounts the hierarchy itself, hybrid setups mount it below
+    if (access((kCgroupPath + "/cgroup.controllers").c_str(), F_OK) == 0) {
+      return kCgroupPath;
+    }
+    if (access((kCgroupPath + "/unified/cgroup.controllers").c_str(), F_OK) ==
+        0) {
+      return kCgroupPath + "/unified";
+    }
+    return string();
+  }();
+  return root;
+}
@@ -0,0 +1,72 @@
+#include <algorithm>
+
+#include "list_view.h"
+
+void ListView::Resize(int height) {
+  this->height = std::max(1, height);
+  Clamp();
+}
+
+void ListView::SetCount(size_t count) {
+  this->count = count;
+  Clamp();
+}
+
+// Moves the selection, scrolling only once it would leave the window
+void ListView::Move(long rows) {
+  if (rows < 0 && static_cast<size_t>(-rows) > selected) {
+    selected = 0;
+  } else {
+    selected += rows;
+  }
+  Clamp();
+}
+
+void ListView::Page(long pages) {
+  const long rows = pages * height;
+  if (rows < 0 && static_cast<size_t>(-rows) > first) {
+    first = 0;
+  } else {
+    first += rows;
+  }
+  Move(rows);
+}
+
+void ListView::Home() { Select(0); }
+
+void ListView::End() { Select(count); }
+
+void ListView::Select(size_t index) {
+  selected = index;
+  Clamp();
+}
+
+void ListView::Follow(size_t index) {
+  const size_t row = selected - first;
+  first = index >= row ? index - row : 0;
+  selected = index;
+  Clamp();
+}
+
+// Return the index of the top visible row
+size_t ListView::First() const { return first; }
+
+// Return the index of the selected row
+size_t ListView::Selected() const { return selected; }
+
+size_t ListView::Count() const { return count; }
+
+int ListView::Height() const { return height; }
+
+// Keeps the selection in the list and the window on the selection,
+// without leaving blank rows at the bottom
+void ListView::Clamp() {
+  selected = count == 0 ? 0 : std::min(selected, count - 1);
+  const size_t rows = height;
+  first = std::min(first, count > rows ? count - rows : 0);
+  if (selected < first) {
+    first = selected;
+  } else if (selected >= first + rows) {
+    first = selected - rows + 1;
+  }
+}
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <sstream>
+#include <spawn.h>
+#include <stdexcept>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "load_generator.h"
+
+extern char **environ;
+
+using std::string;
+
+namespace {
+// Reads the number of a key=value pair, throws std::invalid_argument
+double Number(string const &pair, string const &value) {
+  char *end;
+  double number = std::strtod(value.c_str(), &end);
+  if (value.empty() || *end != '\0' || number < 0) {
+    throw std::invalid_argument("expected a number in '" + pair + "'");
+  }
+  return number;
+}
+} // namespace
+
+// Parses comma separated key=value pairs
+WorkerSpec WorkerSpec::Parse(string const &text) {
+  WorkerSpec spec;
+  std::istringstream stream(text);
+  string pair;
+  while (std::getline(stream, pair, ',')) {
+    if (pair.empty()) {
+      continue;
+    }
+    size_t equals = pair.find('=');
+    if (equals == string::npos) {
+      throw std::invalid_argument("expected <key>=<value> in '" + pair + "'");
+    }
+    const string key = pair.substr(0, equals);
+    const string value = pair.substr(equals + 1);
+    if (key == "cpu") {
+      spec.duty = Number(pair, value);
+      if (spec.duty > 1.0) {
+        throw std::invalid_argument("cpu is a share within 0..1");
+      }
+    } else if (key == "period") {
+      spec.period_ms = std::max(1L, static_cast<long>(Number(pair, value)));
+    } else if (key == "mem") {
+      spec.memory_kb = Number(pair, value);
+    } else if (key == "touch") {
+      if (value != "random" && value != "sequential") {
+        throw std::invalid_argument("touch is random or sequential");
+      }
+      spec.random_touch = value == "random";
+    } else if (key == "io") {
+      spec.io_kb = Number(pair, value);
+    } else if (key == "duration") {
+      spec.duration_s = Number(pair, value);
+    } else if (key == "seed") {
+      Number(pair, value);
+      spec.seed = std::strtoull(value.c_str(), nullptr, 10);
+    } else {
+      throw std::invalid_argument("unknown key '" + key + "'");
+    }
+  }
+  return spec;
+}
+
+// Returns the spec in the form Parse reads
+string WorkerSpec::Text() const {
+  char text[160];
+  std::snprintf(text, sizeof(text),
+                "cpu=%g,period=%ld,mem=%ld,touch=%s,io=%ld,duration=%ld,"
+                "seed=%llu",
+                duty, period_ms, memory_kb,
+                random_touch ? "random" : "sequential", io_kb, duration_s,
+                static_cast<unsigned long long>(seed));
+  return text;
+}
+
+LoadGenerator::~LoadGenerator() { Stop(); }
+
+// Re-executes this binary so the worker is a process of its own that the
+// monitor shows and SIGSTOP/SIGCONT can schedule
+pid_t LoadGenerator::Spawn(WorkerSpec spec) {
+  spec.seed += spawned++;
+  const string text = spec.Text();
+  char program[] = "monitor";
+  char flag[] = "--worker";
+  char *argv[] = {program, flag, const_cast<char *>(text.c_str()), nullptr};
+  pid_t pid;
+  int error = posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, argv,
+                          environ);
+  if (error != 0) {
+    throw std::runtime_error(string("posix_spawn: ") + std::strerror(error));
+  }
+  workers.push_back(pid);
+  return pid;
+}
+
+void LoadGenerator::Pause(size_t worker) {
+  if (worker < workers.size()) {
+    kill(workers[worker], SIGSTOP);
+  }
+}
+
+void LoadGenerator::Resume(size_t worker) {
+  if (worker < workers.size()) {
+    kill(workers[worker], SIGCONT);
+  }
+}
+
+std::vector<pid_t> const &LoadGenerator::Workers() const { return workers; }
+
+size_t LoadGenerator::Reap() {
+  for (size_t i = 0; i < workers.size();) {
+    if (waitpid(workers[i], nullptr, WNOHANG) == workers[i]) {
+      workers.erase(workers.begin() + i);
+    } else {
+      ++i;
+    }
+  }
+  return workers.size();
+}
+
+// A stopped worker only acts on SIGTERM once continued
+void LoadGenerator::Stop() {
+  for (pid_t pid : workers) {
+    kill(pid, SIGTERM);
+    kill(pid, SIGCONT);
+  }
+  for (pid_t pid : workers) {
+    waitpid(pid, nullptr, 0);
+  }
+  workers.clear();
+}
+
+void LoadGenerator::RunWorker(WorkerSpec const &spec) {
+  prctl(PR_SET_NAME, "load-worker");
+  // Never outlive the generator, even if it is killed
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+  using Clock = std::chrono::steady_clock;
+  const long page = sysconf(_SC_PAGESIZE);
+  std::vector<char> memory(spec.memory_kb * 1024);
+  std::vector<char> block(spec.io_kb * 1024, 'x');
+  int io_fd{-1};
+  if (!block.empty()) {
+    // Anonymous file, gone when the worker exits
+    io_fd = open("/tmp", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+  }
+  std::mt19937_64 random(spec.seed);
+  const long pages = memory.size() / page;
+  long next_page{0};
+
+  const auto start = Clock::now();
+  const auto period = std::chrono::milliseconds(spec.period_ms);
+  const auto busy = std::chrono::duration_cast<Clock::duration>(
+      period * spec.duty);
+  volatile unsigned long sink{0};
+  for (auto next = start;
+       spec.duration_s == 0 ||
+       Clock::now() - start < std::chrono::seconds(spec.duration_s);) {
+    const auto busy_until = next + busy;
+    while (Clock::now() < busy_until) {
+      for (int i = 0; i < 1024; ++i) {
+        sink = sink + i;
+      }
+    }
+    for (long i = 0; i < pages; ++i) {
+      const long at = spec.random_touch ? random() % pages : next_page++;
+      ++memory[(at % pages) * page];
+    }
+    if (io_fd >= 0) {
+      if (pwrite(io_fd, block.data(), block.size(), 0) > 0) {
+        fdatasync(io_fd);
+      }
+    }
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+  if (io_fd >= 0) {
+    close(io_fd);
+  }
+}
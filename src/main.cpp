@@ -1,7 +1,441 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "agent.h"
+#include "alerts.h"
+#include "exporter.h"
+#include "filter.h"
+#include "linux_parser.h"
+#include "load_generator.h"
 #include "ncurses_display.h"
+#include "network.h"
+#include "scheduler.h"
+#include "session.h"
+#include "sweep.h"
 #include "system.h"
+#include "trace.h"
+
+namespace {
+const char kUsage[] =
+    "usage: monitor [options]\n"
+    "  --profile <file>        dump the monitor's own stage costs on exit\n"
+    "  --filter <expression>   only show matching processes\n"
+    "  --export <port>         serve OpenMetrics on 127.0.0.1:<port>/metrics\n"
+    "  --agent <address>       collect headless and serve viewers on address\n"
+    "  --connect <address>     view an agent instead, may be repeated\n"
+    "                          addresses are unix:<path> or <host>:<port>\n"
+    "  --record-trace <file> [--duration <s>]\n"
+    "                          record a scheduling trace\n"
+    "  --replay <file> [--quantum <ms>]\n"
+    "                          simulate every policy on a trace\n"
+    "  --cores <n> [--migration-cost <ms>]\n"
+    "                          replay on 1, 2, 4 ... n cores under every\n"
+    "                          load-balancing strategy\n"
+    "  --sweep [--workloads <n>] [--jobs <n>] [--seed <n>] [--threads <n>]\n"
+    "                          rank scheduler settings on random workloads\n"
+    "  --bench-scheduler [--jobs <n>]\n"
+    "                          dispatches per second of the simulation loops\n"
+    "  --load <spec> [--workers <n>]\n"
+    "                          run n load workers while monitoring\n"
+    "  --alerts <file>         alert rules instead of CPU above 80%\n"
+    "  --alert-log <file>, --alert-hook <command>\n"
+    "                          where alert events go\n"
+    "  --record-session <file> [--duration <s>] [--interval <ms>]\n"
+    "                          record every process on every scan\n"
+    "  --diff <before> <after> compare two recorded sessions\n"
+    "  --uring                 read /proc through io_uring if available\n"
+    "  --bench-scan [--ticks <n>]\n"
+    "                          syscalls and wall time per process scan\n"
+    "  --bench-sockets [--ticks <n>]\n"
+    "                          cost of the cold and the cached socket index\n";
+
+// Returns the value of a numeric option, throws std::invalid_argument
+// unless it is an integer in [minimum, maximum] of the option's type
+template <typename T>
+T Number(std::string const &option, const char *value, T minimum,
+         T maximum = std::numeric_limits<T>::max()) {
+  size_t end{0};
+  long long number{0};
+  try {
+    number = std::stoll(value, &end);
+  } catch (std::logic_error const &) {
+    end = 0;
+  }
+  if (end == 0 || value[end] != '\0' || number < minimum ||
+      number > maximum) {
+    const std::string range =
+        maximum < std::numeric_limits<T>::max() || number > maximum
+            ? "from " + std::to_string(minimum) + " to " +
+                  std::to_string(maximum)
+            : "of at least " + std::to_string(minimum);
+    throw std::invalid_argument(option + " expects an integer " + range +
+                                ", got '" + value + "'");
+  }
+  return static_cast<T>(number);
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  // Options: see kUsage
+  if (argc == 3 && std::string(argv[1]) == "--worker") {
+    // A load worker spawned by LoadGenerator
+    LoadGenerator::RunWorker(WorkerSpec::Parse(argv[2]));
+    return 0;
+  }
+
+  std::string profile_path;
+  std::string filter;
+  int export_port{-1};
+  std::string agent_address;
+  std::vector<std::string> agents;
+  std::string record_path;
+  int duration{60};
+  std::string replay_path;
+  std::string session_path;
+  int interval_ms{1000};
+  std::vector<std::string> diff_paths;
+  Scheduler::Options options;
+  bool sweep{false};
+  bool bench_scheduler{false};
+  bool uring{false};
+  bool bench_scan{false};
+  bool bench_sockets{false};
+  int ticks{20};
+  std::string load_spec;
+  std::string alerts_path;
+  std::string alert_log;
+  std::string alert_hook;
+  int load_workers{1};
+  int workloads{30};
+  long jobs{0}; // per workload, the mode picks a default
+  unsigned long seed{1};
+  int threads{0};
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (arg == "--help" || arg == "-h") {
+        std::cout << kUsage;
+        return 0;
+      } else if (arg == "--profile" && i + 1 < argc) {
+        profile_path = argv[++i];
+      } else if (arg == "--filter" && i + 1 < argc) {
+        filter = argv[++i];
+      } else if (arg == "--export" && i + 1 < argc) {
+        export_port = Number<int>(arg, argv[++i], 0, 65535);
+      } else if (arg == "--agent" && i + 1 < argc) {
+        agent_address = argv[++i];
+      } else if (arg == "--connect" && i + 1 < argc) {
+        agents.push_back(argv[++i]);
+      } else if (arg == "--record-trace" && i + 1 < argc) {
+        record_path = argv[++i];
+      } else if (arg == "--duration" && i + 1 < argc) {
+        duration = Number<int>(arg, argv[++i], 1);
+      } else if (arg == "--record-session" && i + 1 < argc) {
+        session_path = argv[++i];
+      } else if (arg == "--interval" && i + 1 < argc) {
+        interval_ms = Number<int>(arg, argv[++i], 1);
+      } else if (arg == "--diff" && i + 2 < argc) {
+        diff_paths = {argv[i + 1], argv[i + 2]};
+        i += 2;
+      } else if (arg == "--replay" && i + 1 < argc) {
+        replay_path = argv[++i];
+      } else if (arg == "--quantum" && i + 1 < argc) {
+        options.quantum = Number<long>(arg, argv[++i], 1);
+      } else if (arg == "--cores" && i + 1 < argc) {
+        options.cores = Number<int>(arg, argv[++i], 1);
+      } else if (arg == "--migration-cost" && i + 1 < argc) {
+        options.migration_cost = Number<long>(arg, argv[++i], 0);
+      } else if (arg == "--alerts" && i + 1 < argc) {
+        alerts_path = argv[++i];
+      } else if (arg == "--alert-log" && i + 1 < argc) {
+        alert_log = argv[++i];
+      } else if (arg == "--alert-hook" && i + 1 < argc) {
+        alert_hook = argv[++i];
+      } else if (arg == "--load" && i + 1 < argc) {
+        load_spec = argv[++i];
+      } else if (arg == "--workers" && i + 1 < argc) {
+        load_workers = Number<int>(arg, argv[++i], 1);
+      } else if (arg == "--uring") {
+        uring = true;
+      } else if (arg == "--bench-scan") {
+        bench_scan = true;
+      } else if (arg == "--bench-sockets") {
+        bench_sockets = true;
+      } else if (arg == "--ticks" && i + 1 < argc) {
+        ticks = Number<int>(arg, argv[++i], 1);
+      } else if (arg == "--bench-scheduler") {
+        bench_scheduler = true;
+      } else if (arg == "--sweep") {
+        sweep = true;
+      } else if (arg == "--workloads" && i + 1 < argc) {
+        workloads = Number<int>(arg, argv[++i], 1);
+      } else if (arg == "--jobs" && i + 1 < argc) {
+        jobs = Number<long>(arg, argv[++i], 0);
+      } else if (arg == "--seed" && i + 1 < argc) {
+        seed = Number<long>(arg, argv[++i], 0);
+      } else if (arg == "--threads" && i + 1 < argc) {
+        threads = Number<int>(arg, argv[++i], 0);
+      }
+    }
+  } catch (std::invalid_argument const &e) {
+    std::cerr << e.what() << "\n" << kUsage;
+    return 1;
+  }
+
+  if (bench_scheduler) {
+    // Generated up front so that both loops only pay for scheduling
+    std::vector<Scheduler::Job> workload;
+    Sweep::RandomSource random(seed, jobs > 0 ? jobs : 1000000);
+    for (Scheduler::Job job; random.Next(job);) {
+      workload.push_back(job);
+    }
+    std::printf("%-8s %16s %16s %8s\n", "POLICY", "VIRTUAL /s",
+                "SPECIALIZED /s", "SPEEDUP");
+    for (int kind = 0; kind < Scheduler::kPolicyCount_; ++kind) {
+      double rates[2];
+      std::string name;
+      for (int specialized = 0; specialized < 2; ++specialized) {
+        Scheduler::VectorSource source(workload);
+        auto start = std::chrono::steady_clock::now();
+        Scheduler::Result result;
+        if (specialized) {
+          result = Scheduler::Simulate(
+              static_cast<Scheduler::PolicyKind>(kind), source, options);
+        } else {
+          auto policy = Scheduler::MakePolicy(
+              static_cast<Scheduler::PolicyKind>(kind), options);
+          result = Scheduler::Simulate(*policy, source, options);
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        rates[specialized] = result.dispatches / elapsed.count();
+        name = result.policy;
+      }
+      std::printf("%-8s %16.0f %16.0f %7.2fx\n", name.c_str(), rates[0],
+                  rates[1], rates[1] / rates[0]);
+    }
+    return 0;
+  }
+  if (sweep) {
+    auto summaries =
+        Sweep::Run(Sweep::Grid(), workloads, jobs > 0 ? jobs : 5000, seed,
+                   threads);
+    std::stable_sort(summaries.begin(), summaries.end(),
+                     [](Sweep::Summary const &a, Sweep::Summary const &b) {
+                       return a.wait < b.wait;
+                     });
+    std::cout << Sweep::FormatHeader() << "\n";
+    for (auto const &summary : summaries) {
+      std::cout << Sweep::FormatSummary(summary) << "\n";
+    }
+    return 0;
+  }
+  if (!diff_paths.empty()) {
+    try {
+      std::cout << Session::FormatReport(
+          Session::Diff(diff_paths[0], diff_paths[1]));
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Could not diff: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+  if (!replay_path.empty() && options.cores > 1) {
+    std::cout << Scheduler::FormatCoresHeader() << "\n";
+    const int max_cores = options.cores;
+    try {
+      for (int kind = 0; kind < Scheduler::kPolicyCount_; ++kind) {
+        for (int balance = 0; balance < Scheduler::kBalanceCount_;
+             ++balance) {
+          options.balance = static_cast<Scheduler::Balance>(balance);
+          for (int cores = 1; cores <= max_cores;
+               cores = cores < max_cores && cores * 2 > max_cores
+                           ? max_cores
+                           : cores * 2) {
+            options.cores = cores;
+            Trace::Reader reader(replay_path);
+            std::cout << Scheduler::FormatCoresResult(Scheduler::SimulateCores(
+                             static_cast<Scheduler::PolicyKind>(kind), reader,
+                             options))
+                      << "\n";
+          }
+        }
+      }
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Could not replay: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+  if (!replay_path.empty()) {
+    // Each policy streams the trace again rather than sharing a copy
+    std::cout << Scheduler::FormatHeader() << "\n";
+    try {
+      for (int kind = 0; kind < Scheduler::kPolicyCount_; ++kind) {
+        Trace::Reader reader(replay_path);
+        std::cout << Scheduler::FormatResult(Scheduler::Simulate(
+                         static_cast<Scheduler::PolicyKind>(kind), reader,
+                         options))
+                  << "\n";
+      }
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Could not replay: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
+  std::unique_ptr<Alerts> alerts;
+  try {
+    alerts = std::make_unique<Alerts>(
+        alerts_path.empty()
+            ? std::vector<Alerts::Rule>{Alerts::Parse(
+                  "cpu_high system.cpu last 0 > 80")}
+            : Alerts::Load(alerts_path));
+    if (!alert_log.empty()) {
+      alerts->SetLog(alert_log);
+    }
+    alerts->SetHook(alert_hook);
+  } catch (std::exception const &e) {
+    std::cerr << "Invalid alerts: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (!agents.empty()) {
+    try {
+      NCursesDisplay::DisplayRemote(agents, 10, alerts.get());
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Could not connect: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
+  // Stopped and reaped when main returns
+  LoadGenerator load;
+  if (!load_spec.empty()) {
+    try {
+      WorkerSpec spec = WorkerSpec::Parse(load_spec);
+      for (int i = 0; i < load_workers; ++i) {
+        load.Spawn(spec);
+      }
+    } catch (std::exception const &e) {
+      std::cerr << "Could not start load: " << e.what() << "\n";
+      return 1;
+    }
+  }
 
-int main() {
   System system;
-  NCursesDisplay::Display(system);
-}
\ No newline at end of file
+  try {
+    system.SetFilter(Filter(filter));
+  } catch (std::invalid_argument const &e) {
+    std::cerr << "Invalid filter: " << e.what() << "\n";
+    return 1;
+  }
+  if (bench_scan) {
+    std::printf("%-8s %10s %16s %12s\n", "READER", "PROCESSES",
+                "SYSCALLS/TICK", "MS/TICK");
+    for (int with_uring = 0; with_uring < 2; ++with_uring) {
+      System scanner;
+      scanner.SetFilter(Filter(filter));
+      const char *name = with_uring ? "io_uring" : "sync";
+      if (with_uring && !scanner.EnableUring()) {
+        std::printf("%-8s %10s\n", name, "unavailable");
+        continue;
+      }
+      // The first scan also reads every command line, leave it out
+      scanner.Processes();
+      const long syscalls = scanner.Reader().Syscalls();
+      size_t processes{0};
+      auto start = std::chrono::steady_clock::now();
+      for (int tick = 0; tick < ticks; ++tick) {
+        processes += scanner.Processes().size();
+      }
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::printf("%-8s %10zu %16.0f %12.2f\n", name, processes / ticks,
+                  static_cast<double>(scanner.Reader().Syscalls() - syscalls) /
+                      ticks,
+                  elapsed.count() / ticks);
+    }
+    return 0;
+  }
+  if (bench_sockets) {
+    Network network;
+    std::vector<int> pids;
+    std::printf("%-8s %10s %10s %12s %12s\n", "REFRESH", "PROCESSES",
+                "OWNED", "TABLES/TICK", "MS/TICK");
+    for (int cached = 0; cached < 2; ++cached) {
+      const int count = cached ? ticks : 1;
+      const long walks = network.Walks();
+      size_t attributed{0};
+      double elapsed{0.0};
+      for (int tick = 0; tick < count; ++tick) {
+        LinuxParser::Pids(pids);
+        auto start = std::chrono::steady_clock::now();
+        network.SampleSockets(pids);
+        elapsed += std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+        for (int pid : pids) {
+          attributed += network.Of(pid).Count();
+        }
+      }
+      std::printf("%-8s %10zu %10zu %12.1f %12.2f\n",
+                  cached ? "cached" : "cold", pids.size(), attributed / count,
+                  static_cast<double>(network.Walks() - walks) / count,
+                  elapsed / count);
+    }
+    std::printf("sockets listed through %s\n",
+                network.Diag() ? "sock_diag" : "/proc/net");
+    return 0;
+  }
+  if (uring && !system.EnableUring()) {
+    std::cerr << "io_uring unavailable, reading /proc synchronously\n";
+  }
+  if (!record_path.empty()) {
+    try {
+      Trace::Record(system, record_path, duration);
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Could not record: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+  if (!session_path.empty()) {
+    try {
+      Session::Record(system, session_path, duration, interval_ms);
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Could not record: " << e.what() << "\n";
+      return 1;
+    }
+    return 0;
+  }
+  if (!agent_address.empty()) {
+    try {
+      Agent::Serve(system, agent_address);
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Could not serve: " << e.what() << "\n";
+      return 1;
+    }
+  }
+
+  std::unique_ptr<Exporter> exporter;
+  if (export_port >= 0) {
+    try {
+      exporter = std::make_unique<Exporter>(export_port);
+    } catch (std::runtime_error const &e) {
+      std::cerr << "Could not start exporter: " << e.what() << "\n";
+      return 1;
+    }
+  }
+  NCursesDisplay::Display(system, 10, profile_path, exporter.get(),
+                          alerts.get());
+}
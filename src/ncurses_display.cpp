@@ -1,13 +1,24 @@
 #include "ncurses_display.h"
 #include "format.h"
+#include "instrumentation.h"
+#include "linux_parser.h"
+#include "list_view.h"
+#include "load_generator.h"
+#include "protocol.h"
+#include "sampler.h"
+#include "scheduler.h"
 #include "system.h"
 #include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <hybridalgo.h>
 #include <iostream>
+#include <memory>
+#include <poll.h>
 #include <queue>
 #include <signal.h>
+#include <sys/socket.h>
+#include <stdexcept>
 #include <thread>
 #include <unistd.h>
 #include <vector>
@@ -21,16 +32,28 @@ struct GanttData {
   int completion;
 };
 
-struct SimulatedProcess {
-  int pid;
-  int arrivalTime;
-  int burstTime;
-  int remainingTime;
-  std::string status = "Waiting";
+// Simulated processes as parallel arrays, one column per field
+struct SimulatedProcesses {
+  std::vector<int> pid;
+  std::vector<int> arrivalTime;
+  std::vector<int> burstTime;
+  std::vector<int> remainingTime;
+  std::vector<Scheduler::TaskState> state;
+
+  void Add(int pid, int arrival, int burst) {
+    this->pid.push_back(pid);
+    arrivalTime.push_back(arrival);
+    burstTime.push_back(burst);
+    remainingTime.push_back(burst);
+    state.push_back(Scheduler::kWaiting_);
+  }
+  int Size() const { return pid.size(); }
 };
 
-std::string NCursesDisplay::ProgressBar(float percent) {
-  std::string result{"0%"};
+std::string const &NCursesDisplay::ProgressBar(float percent) {
+  // Reused between calls so that redraws do not allocate
+  static std::string result;
+  result = "0%";
   int size{50};
   float bars{percent * size};
 
@@ -41,7 +64,10 @@ std::string NCursesDisplay::ProgressBar(float percent) {
   string display{to_string(percent * 100).substr(0, 4)};
   if (percent < 0.1 || percent == 1.0)
     display = " " + to_string(percent * 100).substr(0, 3);
-  return result + " " + display + "/100%";
+  result += " ";
+  result += display;
+  result += "/100%";
+  return result;
 }
 
 std::string SimProgressBar(float percent) {
@@ -70,14 +96,15 @@ void DisplaySimSystem(float cpuUtil, int totalProc, int runProc,
   wrefresh(win);
 }
 
-void DisplaySimProcesses(std::vector<SimulatedProcess> &proc, WINDOW *win) {
+void DisplaySimProcesses(SimulatedProcesses const &proc, WINDOW *win) {
   int row = 1;
   wattron(win, COLOR_PAIR(2));
   mvwprintw(win, row++, 2, "PID  ARR  BUR  REM  STATUS");
   wattroff(win, COLOR_PAIR(2));
-  for (auto &p : proc) {
-    mvwprintw(win, row++, 2, "%4d  %3d  %3d  %3d  %s", p.pid, p.arrivalTime,
-              p.burstTime, p.remainingTime, p.status.c_str());
+  for (int i = 0; i < proc.Size(); ++i) {
+    mvwprintw(win, row++, 2, "%4d  %3d  %3d  %3d  %-7s", proc.pid[i],
+              proc.arrivalTime[i], proc.burstTime[i], proc.remainingTime[i],
+              Scheduler::StateName(proc.state[i]));
   }
   wrefresh(win);
 }
@@ -85,42 +112,42 @@ void DisplaySimProcesses(std::vector<SimulatedProcess> &proc, WINDOW *win) {
 void SimulateScheduling(WINDOW *sysWin, WINDOW *procWin, WINDOW *outWin,
                         int timeQuantum = 2) {
   int time = 0, pidCounter = 1000;
-  std::vector<SimulatedProcess> allProcesses = {{pidCounter++, 0, 5, 5},
-                                                {pidCounter++, 1, 4, 4},
-                                                {pidCounter++, 2, 6, 6},
-                                                {pidCounter++, 3, 3, 3},
-                                                {pidCounter++, 4, 2, 2}};
+  SimulatedProcesses allProcesses;
+  allProcesses.Add(pidCounter++, 0, 5);
+  allProcesses.Add(pidCounter++, 1, 4);
+  allProcesses.Add(pidCounter++, 2, 6);
+  allProcesses.Add(pidCounter++, 3, 3);
+  allProcesses.Add(pidCounter++, 4, 2);
 
   std::queue<int> readyQueue;
-  std::vector<bool> arrived(allProcesses.size(), false);
   int active = -1;
   int quantumLeft = 0;
 
   while (true) {
-    for (int i = 0; i < allProcesses.size(); ++i) {
-      if (!arrived[i] && allProcesses[i].arrivalTime <= time) {
+    for (int i = 0; i < allProcesses.Size(); ++i) {
+      if (allProcesses.state[i] == Scheduler::kWaiting_ &&
+          allProcesses.arrivalTime[i] <= time) {
         readyQueue.push(i);
-        allProcesses[i].status = "Ready";
-        arrived[i] = true;
+        allProcesses.state[i] = Scheduler::kReady_;
       }
     }
 
     if ((active == -1 || quantumLeft == 0) && !readyQueue.empty()) {
-      if (active != -1 && allProcesses[active].remainingTime > 0) {
-        allProcesses[active].status = "Ready";
+      if (active != -1 && allProcesses.remainingTime[active] > 0) {
+        allProcesses.state[active] = Scheduler::kReady_;
         readyQueue.push(active);
       }
       active = readyQueue.front();
       readyQueue.pop();
-      allProcesses[active].status = "Running";
+      allProcesses.state[active] = Scheduler::kRunning_;
       quantumLeft = timeQuantum;
     }
 
     if (active != -1) {
-      allProcesses[active].remainingTime--;
+      allProcesses.remainingTime[active]--;
       quantumLeft--;
-      if (allProcesses[active].remainingTime == 0) {
-        allProcesses[active].status = "Done";
+      if (allProcesses.remainingTime[active] == 0) {
+        allProcesses.state[active] = Scheduler::kDone_;
         active = -1;
       }
     }
@@ -130,7 +157,7 @@ void SimulateScheduling(WINDOW *sysWin, WINDOW *procWin, WINDOW *outWin,
     box(sysWin, 0, 0);
     box(procWin, 0, 0);
     box(outWin, 0, 0);
-    DisplaySimSystem(cpuUtil, allProcesses.size(), active != -1 ? 1 : 0, time,
+    DisplaySimSystem(cpuUtil, allProcesses.Size(), active != -1 ? 1 : 0, time,
                      sysWin);
     DisplaySimProcesses(allProcesses, procWin);
     mvwprintw(outWin, 1, 2, "Round Robin (TQ = %d) Simulation Running...",
@@ -140,8 +167,9 @@ void SimulateScheduling(WINDOW *sysWin, WINDOW *procWin, WINDOW *outWin,
     std::this_thread::sleep_for(std::chrono::milliseconds(800));
     time++;
 
-    bool allDone = std::all_of(allProcesses.begin(), allProcesses.end(),
-                               [](auto &p) { return p.remainingTime == 0; });
+    bool allDone = std::all_of(allProcesses.remainingTime.begin(),
+                               allProcesses.remainingTime.end(),
+                               [](int remaining) { return remaining == 0; });
     if (allDone)
       break;
   }
@@ -151,123 +179,222 @@ void SimulateScheduling(WINDOW *sysWin, WINDOW *procWin, WINDOW *outWin,
   getch();
 }
 
-void AddProcessesInteractive(int numProcesses, bool withScheduling = false,
+// Starts numProcesses workers half a second apart and returns the seconds
+// until the CPU reaches 80%, or -1 if it does not before every worker has
+// exited, or at the latest by the end of the last one's lifetime. With
+// scheduling only one worker runs at a time, switched every timeQuantum
+// seconds with SIGSTOP/SIGCONT.
+double MeasureCPUUtilization(System &system, WINDOW *window, int row,
+                             int numProcesses, bool withScheduling = false,
                              int timeQuantum = 1) {
-  std::vector<pid_t> pids;
-  for (int i = 0; i < numProcesses; ++i) {
-    pid_t pid = fork();
-    if (pid < 0) {
-      perror("Fork failed");
-      exit(EXIT_FAILURE);
-    } else if (pid == 0) {
-      // Simulate the work
-      auto start_time = std::chrono::steady_clock::now();
-      std::chrono::seconds duration(15);
-      while (true) {
-        if (std::chrono::steady_clock::now() - start_time > duration) {
-          break;
-        }
+  WorkerSpec spec;
+  spec.duration_s = 15;
+  LoadGenerator load;
+  auto const spawn_interval = std::chrono::milliseconds(500);
+  auto const start_time = std::chrono::steady_clock::now();
+  // The last spawn plus its lifetime, and a second to reap it
+  auto const deadline = start_time + spawn_interval * numProcesses +
+                        std::chrono::seconds(spec.duration_s + 1);
+  auto next_spawn = start_time;
+  auto slice_end = start_time;
+  int spawned{0};
+  size_t current{0};
+  while (true) {
+    auto now = std::chrono::steady_clock::now();
+    // Exited workers are not replaced, their slots stay used
+    size_t const alive{load.Reap()};
+    if ((spawned == numProcesses && alive == 0) || now >= deadline) {
+      break;
+    }
+    if (spawned < numProcesses && now >= next_spawn) {
+      load.Spawn(spec);
+      ++spawned;
+      if (withScheduling && load.Workers().size() > 1) {
+        load.Pause(load.Workers().size() - 1);
       }
-      exit(0); // Exit child process
-    } else {
-      pids.push_back(pid);
-      std::cout << "Added process PID: " << pid << "\n";
-      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      next_spawn = now + spawn_interval;
     }
-  }
-
-  if (withScheduling) {
-
-    while (!pids.empty()) {
-      for (size_t i = 0; i < pids.size(); ++i) {
-        pid_t currentProcess = pids[i];
-        std::cout << "Sending SIGCONT to PID: " << currentProcess << std::endl;
-        kill(currentProcess, SIGCONT);
-        std::this_thread::sleep_for(std::chrono::seconds(timeQuantum));
-        std::cout << "Sending SIGSTOP to PID: " << currentProcess << std::endl;
-        kill(currentProcess, SIGSTOP);
+    size_t const count{load.Workers().size()};
+    if (withScheduling && now >= slice_end && count > 0) {
+      // Reaping shifts the workers, pause them all rather than one index
+      for (size_t worker = 0; worker < count; ++worker) {
+        load.Pause(worker);
       }
+      current = (current + 1) % count;
+      load.Resume(current);
+      slice_end = now + std::chrono::seconds(timeQuantum);
     }
-  }
-}
 
-double MeasureCPUUtilization(System &system, int numProcesses,
-                             bool withScheduling = false, int timeQuantum = 1) {
-  AddProcessesInteractive(numProcesses, withScheduling, timeQuantum);
-  auto start_time = std::chrono::steady_clock::now();
-  while (true) {
     float cpuUtilization = system.Cpu().Utilization();
     int cpuPercent = static_cast<int>(cpuUtilization * 100);
-    std::cout << "CPU Utilization: " << cpuPercent << "%\n";
-
+    mvwprintw(window, row, 1, "CPU Utilization: %3d%% with %zu workers",
+              cpuPercent, count);
+    wrefresh(window);
     if (cpuPercent >= 80) {
-      auto end_time = std::chrono::steady_clock::now();
-      std::chrono::duration<double> elapsed_seconds = end_time - start_time;
-      std::system("killall -9 test_process");
+      std::chrono::duration<double> elapsed_seconds = now - start_time;
       return elapsed_seconds.count();
     }
     // System Overload measure
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
+  return -1;
 }
 
 void CompareScheduling(System &system, WINDOW *output_window) {
   int numProcesses = 10;
   int timeQuantum = 2;
 
+  werase(output_window);
+  box(output_window, 0, 0);
   mvwprintw(output_window, 1, 1, "Measuring time without scheduling...");
   wrefresh(output_window);
   double timeWithoutScheduling =
-      MeasureCPUUtilization(system, numProcesses, false);
-  mvwprintw(output_window, 2, 1, "Time without scheduling: %.2f seconds",
-            timeWithoutScheduling);
+      MeasureCPUUtilization(system, output_window, 2, numProcesses, false);
+  if (timeWithoutScheduling < 0) {
+    mvwprintw(output_window, 2, 1, "Time without scheduling: 80%% not reached");
+  } else {
+    mvwprintw(output_window, 2, 1, "Time without scheduling: %.2f seconds",
+              timeWithoutScheduling);
+  }
+  wclrtoeol(output_window);
   wrefresh(output_window);
 
   mvwprintw(output_window, 3, 1, "Measuring time with scheduling...");
   wrefresh(output_window);
-  double timeWithScheduling =
-      MeasureCPUUtilization(system, 20, true, timeQuantum);
-  mvwprintw(output_window, 4, 1, "Time with scheduling: %.2f seconds",
-            timeWithScheduling);
-  wrefresh(output_window);
-
-  mvwprintw(output_window, 5, 1, "Comparison completed.");
+  double timeWithScheduling = MeasureCPUUtilization(
+      system, output_window, 4, 20, true, timeQuantum);
+  if (timeWithScheduling < 0) {
+    mvwprintw(output_window, 4, 1, "Time with scheduling: 80%% not reached");
+  } else {
+    mvwprintw(output_window, 4, 1, "Time with scheduling: %.2f seconds",
+              timeWithScheduling);
+  }
+  wclrtoeol(output_window);
+  box(output_window, 0, 0);
   wrefresh(output_window);
 }
 
 void NCursesDisplay::DisplaySystem(System &system, WINDOW *window) {
+  DisplaySystem(system.Snapshot(), window);
+}
+
+void NCursesDisplay::DisplaySystem(SystemSnapshot const &system,
+                                   WINDOW *window) {
   int row{0};
-  float cpuUtilization = system.Cpu().Utilization();
-  int cpuPercent = static_cast<int>(cpuUtilization * 100);
+  float cpuUtilization = system.cpu;
 
-  mvwprintw(window, ++row, 2, "OS: %s", system.OperatingSystem().c_str());
-  mvwprintw(window, ++row, 2, "Kernel: %s", system.Kernel().c_str());
+  mvwprintw(window, ++row, 2, "OS: %.*s",
+            static_cast<int>(system.operating_system.size()),
+            system.operating_system.data());
+  mvwprintw(window, ++row, 2, "Kernel: %.*s",
+            static_cast<int>(system.kernel.size()), system.kernel.data());
   mvwprintw(window, ++row, 2, "CPU: ");
   wattron(window, COLOR_PAIR(1));
   mvwprintw(window, row, 10, "");
   wprintw(window, ProgressBar(cpuUtilization).c_str());
   wattroff(window, COLOR_PAIR(1));
 
-  if (cpuPercent > 80) {
-    int col = (getmaxx(window) - 40) / 2;
-    mvwprintw(window, ++row, col, "WARNING: CPU Utilization exceeds 80%%!");
-  }
-
   mvwprintw(window, ++row, 2, "Memory: ");
   wattron(window, COLOR_PAIR(1));
   mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.MemoryUtilization()).c_str());
+  wprintw(window, ProgressBar(system.memory).c_str());
   wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2, "Total Processes: %d", system.TotalProcesses());
+  mvwprintw(window, ++row, 2, "Total Processes: %d", system.total_processes);
   mvwprintw(window, ++row, 2, "Running Processes: %d",
-            system.RunningProcesses());
+            system.running_processes);
   mvwprintw(window, ++row, 2, "Up Time: %s",
-            Format::ElapsedTime(system.UpTime()).c_str());
+            Format::ElapsedTime(system.uptime).c_str());
+  wrefresh(window);
+}
+
+// Frequency and energy beside the system bars, if the window is wide
+// enough; the rows below 8 are left to the alerts
+void NCursesDisplay::DisplayPower(Power const &power, WINDOW *window) {
+  int const column{78};
+  int const last_row{7};
+  if (getmaxx(window) < column + 30) {
+    return;
+  }
+  int row{0};
+  if (power.HasFrequency()) {
+    mvwprintw(window, ++row, column, "Frequency: %4.0f/%4.0f MHz",
+              power.Frequency(), power.MaxFrequency());
+    mvwprintw(window, ++row, column, "CPU at full speed: %5.1f%%",
+              power.WeightedUtilization() * 100);
+  } else {
+    mvwprintw(window, ++row, column, "Frequency: n/a");
+  }
+  if (power.Zones().empty()) {
+    mvwprintw(window, ++row, column, "Power: n/a");
+  }
+  for (Power::Zone const &zone : power.Zones()) {
+    if (row == last_row) {
+      break;
+    }
+    mvwprintw(window, ++row, column + 2 * zone.depth, "%-.*s: %6.2f W",
+              16 - 2 * zone.depth, zone.name.c_str(), zone.watts);
+  }
+  wrefresh(window);
+}
+
+// Throughput of all interfaces but loopback, and the busiest one, on the
+// row below the system values
+void NCursesDisplay::DisplayNetwork(Network const &network, WINDOW *window) {
+  double rx{0.0};
+  double tx{0.0};
+  Network::Interface const *busiest{nullptr};
+  for (Network::Interface const &interface : network.Interfaces()) {
+    if (interface.name == "lo") {
+      continue;
+    }
+    rx += interface.rx;
+    tx += interface.tx;
+    if (busiest == nullptr ||
+        interface.rx + interface.tx > busiest->rx + busiest->tx) {
+      busiest = &interface;
+    }
+  }
+  wmove(window, 8, 1);
+  wclrtoeol(window);
+  mvwprintw(window, 8, 2, "Network: rx %.1f KB/s  tx %.1f KB/s", rx / 1024,
+            tx / 1024);
+  if (busiest != nullptr && busiest->rx + busiest->tx > 0.0) {
+    wprintw(window, "  busiest %s", busiest->name.c_str());
+  }
+  box(window, 0, 0);
+  wrefresh(window);
+}
+
+// Lists the firing alerts on the free rows at the bottom of the window
+void NCursesDisplay::DisplayAlerts(Alerts const &alerts, WINDOW *window) {
+  int const first_row{9};
+  int const last_row{getmaxy(window) - 2};
+  auto const &firing = alerts.Firing();
+  for (int row = first_row; row <= last_row; ++row) {
+    wmove(window, row, 1);
+    wclrtoeol(window);
+    size_t const i = row - first_row;
+    if (i >= firing.size()) {
+      continue;
+    }
+    wattron(window, COLOR_PAIR(3));
+    if (row == last_row && firing.size() > i + 1) {
+      mvwprintw(window, row, 2, "ALERT: %zu more", firing.size() - i);
+    } else {
+      mvwprintw(window, row, 2, "ALERT %s: %s at %.1f",
+                firing[i].rule->c_str(), firing[i].entity.c_str(),
+                firing[i].value);
+    }
+    wattroff(window, COLOR_PAIR(3));
+  }
+  box(window, 0, 0);
   wrefresh(window);
 }
 
+// Draws only the rows in view, the selected one highlighted
 void NCursesDisplay::DisplayProcesses(std::vector<Process> &processes,
-                                      WINDOW *window, int n) {
+                                      WINDOW *window, ListView const &view,
+                                      Columns columns) {
   int row{0};
   
   int const pid_column{2};      
@@ -281,98 +408,778 @@ void NCursesDisplay::DisplayProcesses(std::vector<Process> &processes,
   int const time_column{70};    
   int const command_column{80}; 
 
+  // Memory view, sizes in MB, "-" where smaps_rollup was not read
+  int const narrow_user_column{9};
+  int const rss_column{18};
+  int const pss_column{26};
+  int const swap_column{34};
+  int const anon_column{42};
+  int const file_column{50};
+  int const growth_column{58};
+  int const memory_command_column{68};
+
+  // Network view, "-" for processes without sockets
+  int const sockets_column{18};
+  int const established_column{24};
+  int const listen_column{31};
+  int const other_column{38};
+  int const rx_column{45};
+  int const tx_column{56};
+  int const network_command_column{67};
+
   wattron(window, COLOR_PAIR(2));
   
   mvwprintw(window, ++row, pid_column, "PID");
-  mvwprintw(window, row, arr_column, "ARR");
-  mvwprintw(window, row, bur_column, "BUR");
-  mvwprintw(window, row, rem_column, "REM");
-  mvwprintw(window, row, stat_column, "STAT");
-  mvwprintw(window, row, user_column, "USER");
-  mvwprintw(window, row, cpu_column, "CPU%%");
-  mvwprintw(window, row, ram_column, "RAM");
-  mvwprintw(window, row, time_column, "TIME+");
-  mvwprintw(window, row, command_column, "COMMAND");
+  if (columns == kNetworkColumns_) {
+    mvwprintw(window, row, narrow_user_column, "USER");
+    mvwprintw(window, row, sockets_column, "SOCK");
+    mvwprintw(window, row, established_column, "ESTAB");
+    mvwprintw(window, row, listen_column, "LISTEN");
+    mvwprintw(window, row, other_column, "OTHER");
+    mvwprintw(window, row, rx_column, "RX KB/s");
+    mvwprintw(window, row, tx_column, "TX KB/s");
+    mvwprintw(window, row, network_command_column, "COMMAND");
+  } else if (columns == kMemoryColumns_) {
+    mvwprintw(window, row, narrow_user_column, "USER");
+    mvwprintw(window, row, rss_column, "RSS");
+    mvwprintw(window, row, pss_column, "PSS");
+    mvwprintw(window, row, swap_column, "SWAP");
+    mvwprintw(window, row, anon_column, "ANON");
+    mvwprintw(window, row, file_column, "FILE");
+    mvwprintw(window, row, growth_column, "MB/MIN");
+    mvwprintw(window, row, memory_command_column, "COMMAND");
+  } else {
+    mvwprintw(window, row, arr_column, "ARR");
+    mvwprintw(window, row, bur_column, "BUR");
+    mvwprintw(window, row, rem_column, "REM");
+    mvwprintw(window, row, stat_column, "STAT");
+    mvwprintw(window, row, user_column, "USER");
+    mvwprintw(window, row, cpu_column, "CPU%%");
+    mvwprintw(window, row, ram_column, "RAM");
+    mvwprintw(window, row, time_column, "TIME+");
+    mvwprintw(window, row, command_column, "COMMAND");
+  }
   wattroff(window, COLOR_PAIR(2));
 
-  for (int i = 0; i < n && i < static_cast<int>(processes.size()); ++i) {
-    mvwprintw(window, ++row, pid_column, "%d", processes[i].Pid());
-    mvwprintw(window, row, arr_column, "%d", processes[i].ArrivalTime());
-    mvwprintw(window, row, bur_column, "%d", processes[i].BurstTime());
-    mvwprintw(window, row, rem_column, "%d", processes[i].RemainingTime());
-    mvwprintw(window, row, stat_column, "%s", processes[i].Status().c_str());
-    mvwprintw(window, row, user_column, "%s", processes[i].User().c_str());
+  size_t const end{
+      std::min(processes.size(), view.First() + view.Height())};
+  for (size_t i = view.First(); i < end; ++i) {
+    wmove(window, ++row, 1);
+    wclrtoeol(window);
+    if (i == view.Selected()) {
+      wattron(window, A_REVERSE);
+      mvwhline(window, row, 1, ' ', getmaxx(window) - 2);
+    }
+    mvwprintw(window, row, pid_column, "%d", processes[i].Pid());
+    std::string_view user = processes[i].User();
+    std::string_view command = processes[i].Command();
+    if (columns == kNetworkColumns_) {
+      mvwprintw(window, row, narrow_user_column, "%.*s",
+                static_cast<int>(std::min<size_t>(user.size(), 8)),
+                user.data());
+      Network::Sockets const &sockets = processes[i].Sockets();
+      if (sockets.Count() == 0) {
+        mvwprintw(window, row, sockets_column, "-");
+      } else {
+        mvwprintw(window, row, sockets_column, "%d", sockets.Count());
+        mvwprintw(window, row, established_column, "%d",
+                  sockets.states[Network::kEstablished_]);
+        mvwprintw(window, row, listen_column, "%d",
+                  sockets.states[Network::kListen_]);
+        mvwprintw(window, row, other_column, "%d",
+                  sockets.states[Network::kOther_]);
+        mvwprintw(window, row, rx_column, "%.1f", sockets.rx / 1024);
+        mvwprintw(window, row, tx_column, "%.1f", sockets.tx / 1024);
+      }
+      mvwprintw(window, row, network_command_column, "%.*s",
+                static_cast<int>(std::min<size_t>(command.size(), 40)),
+                command.data());
+      wattroff(window, A_REVERSE);
+      continue;
+    }
+    if (columns == kMemoryColumns_) {
+      mvwprintw(window, row, narrow_user_column, "%.*s",
+                static_cast<int>(std::min<size_t>(user.size(), 8)),
+                user.data());
+      mvwprintw(window, row, rss_column, "%ld", processes[i].Ram());
+      LinuxParser::ProcessMemory const &detail = processes[i].Memory();
+      int const columns[] = {pss_column, swap_column, anon_column,
+                             file_column};
+      long const values[] = {detail.pss, detail.swap, detail.anonymous,
+                             detail.file};
+      for (int k = 0; k < 4; ++k) {
+        if (detail.rss == 0) {
+          mvwprintw(window, row, columns[k], "-");
+        } else {
+          mvwprintw(window, row, columns[k], "%.1f", values[k] / 1024.0);
+        }
+      }
+      if (processes[i].Growing()) {
+        wattron(window, COLOR_PAIR(3));
+      }
+      mvwprintw(window, row, growth_column, "%+.2f", processes[i].Growth());
+      wattroff(window, COLOR_PAIR(3));
+      mvwprintw(window, row, memory_command_column, "%.*s",
+                static_cast<int>(std::min<size_t>(command.size(), 40)),
+                command.data());
+      wattroff(window, A_REVERSE);
+      continue;
+    }
+    mvwprintw(window, row, arr_column, "%ld", processes[i].ArrivalTime());
+    mvwprintw(window, row, bur_column, "%ld", processes[i].BurstTime());
+    mvwprintw(window, row, rem_column, "%ld", processes[i].RemainingTime());
+    mvwprintw(window, row, stat_column, "%c", processes[i].Status());
+    mvwprintw(window, row, user_column, "%.*s", static_cast<int>(user.size()),
+              user.data());
 
     float cpu = processes[i].getCpuUtilization() * 100;
     mvwprintw(window, row, cpu_column, "%.1f", cpu);
 
-    mvwprintw(window, row, ram_column, "%s", processes[i].Ram().c_str());
+    mvwprintw(window, row, ram_column, "%ld", processes[i].Ram());
     mvwprintw(window, row, time_column, "%s",
               Format::ElapsedTime(processes[i].UpTime()).c_str());
-    mvwprintw(window, row, command_column, "%.40s",
-              processes[i].Command().c_str());
+    mvwprintw(window, row, command_column, "%.*s",
+              static_cast<int>(std::min<size_t>(command.size(), 40)),
+              command.data());
+    wattroff(window, A_REVERSE);
+  }
+  // Rows below a list shorter than the window
+  while (row < getmaxy(window) - 2) {
+    wmove(window, ++row, 1);
+    wclrtoeol(window);
+  }
+  box(window, 0, 0);
+  if (view.Count() > static_cast<size_t>(view.Height())) {
+    mvwprintw(window, getmaxy(window) - 1, 2, " %zu-%zu of %zu ",
+              view.First() + 1, end, view.Count());
   }
   wrefresh(window);
 }
-void NCursesDisplay::Display(System &system, int n) {
+void NCursesDisplay::DisplayCgroups(std::vector<Cgroup> &cgroups,
+                                    WINDOW *window, ListView const &view) {
+  int row{0};
+  int const procs_column{2};
+  int const cpu_column{9};
+  int const memory_column{17};
+  int const read_column{26};
+  int const write_column{36};
+  int const cgroup_column{46};
+
+  wattron(window, COLOR_PAIR(2));
+  mvwprintw(window, ++row, procs_column, "PROCS");
+  mvwprintw(window, row, cpu_column, "CPU%%");
+  mvwprintw(window, row, memory_column, "MEM(MB)");
+  mvwprintw(window, row, read_column, "READ/s");
+  mvwprintw(window, row, write_column, "WRITE/s");
+  mvwprintw(window, row, cgroup_column, "CGROUP");
+  wattroff(window, COLOR_PAIR(2));
+
+  size_t const end{std::min(cgroups.size(), view.First() + view.Height())};
+  for (size_t i = view.First(); i < end; ++i) {
+    Cgroup const &cgroup = cgroups[i];
+    wmove(window, ++row, 1);
+    wclrtoeol(window);
+    if (i == view.Selected()) {
+      wattron(window, A_REVERSE);
+      mvwhline(window, row, 1, ' ', getmaxx(window) - 2);
+    }
+    mvwprintw(window, row, procs_column, "%d", cgroup.Processes());
+    mvwprintw(window, row, cpu_column, "%.1f",
+              cgroup.getCpuUtilization() * 100);
+    if (cgroup.Memory() >= 0) {
+      mvwprintw(window, row, memory_column, "%ld", cgroup.Memory());
+    } else {
+      mvwprintw(window, row, memory_column, "-");
+    }
+    mvwprintw(window, row, read_column, "%.0fK", cgroup.ReadRate() / 1024);
+    mvwprintw(window, row, write_column, "%.0fK", cgroup.WriteRate() / 1024);
+    std::string_view path = cgroup.Path();
+    mvwprintw(window, row, cgroup_column, "%.*s",
+              static_cast<int>(std::min<size_t>(
+                  path.size(),
+                  std::max(0, getmaxx(window) - cgroup_column - 1))),
+              path.data());
+    wattroff(window, A_REVERSE);
+  }
+  while (row < getmaxy(window) - 2) {
+    wmove(window, ++row, 1);
+    wclrtoeol(window);
+  }
+  box(window, 0, 0);
+  wrefresh(window);
+}
+
+void NCursesDisplay::DisplayTree(std::vector<ProcessTree::Row> const &rows,
+                                 WINDOW *window, ListView const &view) {
+  int row{0};
+  int const pid_column{2};
+  int const user_column{9};
+  int const cpu_column{18};
+  int const ram_column{26};
+  int const tree_cpu_column{34};
+  int const tree_ram_column{44};
+  int const command_column{54};
+
+  wattron(window, COLOR_PAIR(2));
+  mvwprintw(window, ++row, pid_column, "PID");
+  mvwprintw(window, row, user_column, "USER");
+  mvwprintw(window, row, cpu_column, "CPU%%");
+  mvwprintw(window, row, ram_column, "RAM");
+  mvwprintw(window, row, tree_cpu_column, "TREE CPU%%");
+  mvwprintw(window, row, tree_ram_column, "TREE RAM");
+  mvwprintw(window, row, command_column, "COMMAND");
+  wattroff(window, COLOR_PAIR(2));
+
+  size_t const end{std::min(rows.size(), view.First() + view.Height())};
+  for (size_t i = view.First(); i < end; ++i) {
+    ProcessTree::Row const &line = rows[i];
+    Process const &process = *line.process;
+    wmove(window, ++row, 1);
+    wclrtoeol(window);
+    if (i == view.Selected()) {
+      wattron(window, A_REVERSE);
+      mvwhline(window, row, 1, ' ', getmaxx(window) - 2);
+    }
+    mvwprintw(window, row, pid_column, "%d", process.Pid());
+    std::string_view user = process.User();
+    mvwprintw(window, row, user_column, "%.*s",
+              static_cast<int>(std::min<size_t>(user.size(), 8)),
+              user.data());
+    mvwprintw(window, row, cpu_column, "%.1f",
+              process.getCpuUtilization() * 100);
+    mvwprintw(window, row, ram_column, "%ld", process.Ram());
+    mvwprintw(window, row, tree_cpu_column, "%.1f", line.cpu * 100);
+    mvwprintw(window, row, tree_ram_column, "%ld", line.ram);
+    // Two columns per level, deep trees stop indenting
+    int const indent{2 * std::min(line.depth, 12)};
+    char const *marker = !line.children ? "  " : line.collapsed ? "+ " : "- ";
+    std::string_view command = process.Command();
+    mvwprintw(window, row, command_column, "%*s%s%.*s", indent, "", marker,
+              static_cast<int>(std::min<size_t>(
+                  command.size(),
+                  std::max(0, getmaxx(window) - command_column - indent - 3))),
+              command.data());
+    wattroff(window, A_REVERSE);
+  }
+  while (row < getmaxy(window) - 2) {
+    wmove(window, ++row, 1);
+    wclrtoeol(window);
+  }
+  box(window, 0, 0);
+  wrefresh(window);
+}
+
+void NCursesDisplay::DisplayInstrumentation(WINDOW *window) {
+  int row{0};
+  Instrumentation::SampleSelf();
+  wattron(window, COLOR_PAIR(2));
+  mvwprintw(window, ++row, 2,
+            "Monitor: CPU %5.1f%%  RSS %ld kB  syscalls %ld  allocations %ld",
+            Instrumentation::SelfCpuUtilization() * 100,
+            Instrumentation::SelfRss(), Instrumentation::Syscalls(),
+            Instrumentation::Allocations());
+  wattroff(window, COLOR_PAIR(2));
+  for (int i = 0; i < Instrumentation::kStageCount_; ++i) {
+    auto stage = static_cast<Instrumentation::Stage>(i);
+    mvwprintw(window, ++row, 2,
+              "%-6s p50 %8ld us  p99 %8ld us  syscalls %6ld  allocations %6ld",
+              Instrumentation::StageName(stage),
+              Instrumentation::Percentile(stage, 0.5) / 1000,
+              Instrumentation::Percentile(stage, 0.99) / 1000,
+              Instrumentation::LastSyscalls(stage),
+              Instrumentation::LastAllocations(stage));
+  }
+  wrefresh(window);
+}
+
+namespace {
+// Windows of the local view, rebuilt when the terminal is resized
+struct Windows {
+  WINDOW *system{nullptr};
+  WINDOW *processes{nullptr};
+  WINDOW *sim_sys{nullptr};
+  WINDOW *sim_proc{nullptr};
+  WINDOW *sim_out{nullptr};
+  WINDOW *footer{nullptr};
+};
+
+// Creates a window clipped to the screen, shifted up if it would run off
+WINDOW *ClippedWindow(int height, int width, int y, int x) {
+  int const y_max{getmaxy(stdscr)};
+  height = std::max(1, std::min(height, y_max));
+  return newwin(height, std::max(1, width), std::min(y, y_max - height), x);
+}
+
+// The process list takes the rows the simulation panel leaves, but at
+// least n
+void Layout(Windows &windows, int n) {
+  for (WINDOW *window : {windows.system, windows.processes, windows.sim_sys,
+                         windows.sim_proc, windows.sim_out, windows.footer}) {
+    if (window != nullptr) {
+      delwin(window);
+    }
+  }
+  int const x_max{getmaxx(stdscr)};
+  int const y_max{getmaxy(stdscr)};
+  int const system_height{12};
+  int const sim_height{7 + 10 + 5};
+  int const list_height{
+      std::max(3 + n, y_max - system_height - sim_height)};
+  windows.system = ClippedWindow(system_height, x_max - 1, 0, 0);
+  windows.processes =
+      ClippedWindow(list_height, x_max - 1, system_height, 0);
+  int const sim_y{system_height + list_height};
+  windows.sim_sys = ClippedWindow(7, x_max - 2, sim_y, 1);
+  windows.sim_proc = ClippedWindow(10, x_max - 2, sim_y + 7, 1);
+  windows.sim_out = ClippedWindow(5, x_max - 2, sim_y + 17, 1);
+  int const footer_height{2 + Instrumentation::kStageCount_ + 1};
+  windows.footer =
+      ClippedWindow(footer_height, x_max - 1, y_max - footer_height, 0);
+}
+
+// Reads a line on the last row of the screen
+void Prompt(char const *label, char *input, int size) {
+  int const last_row{getmaxy(stdscr) - 1};
+  mvprintw(last_row, 0, "%s", label);
+  clrtoeol();
+  nodelay(stdscr, FALSE);
+  echo();
+  getnstr(input, size - 1);
+  noecho();
+  nodelay(stdscr, TRUE);
+  move(last_row, 0);
+  clrtoeol();
+}
+
+// Applies a scrolling key to view, false if key does not scroll
+bool Scroll(int key, ListView &view) {
+  switch (key) {
+  case KEY_UP:
+    view.Move(-1);
+    return true;
+  case KEY_DOWN:
+    view.Move(1);
+    return true;
+  case KEY_PPAGE:
+    view.Page(-1);
+    return true;
+  case KEY_NPAGE:
+  case ' ':
+    view.Page(1);
+    return true;
+  case KEY_HOME:
+    view.Home();
+    return true;
+  case KEY_END:
+    view.End();
+    return true;
+  default:
+    return false;
+  }
+}
+} // namespace
+
+void NCursesDisplay::Display(System &system, int n,
+                             std::string const &profile_path,
+                             Exporter *exporter, Alerts *alerts) {
   initscr();
   noecho();
   cbreak();
+  keypad(stdscr, TRUE);
   start_color();
 
-  int x_max{getmaxx(stdscr)};
-  WINDOW *system_window = newwin(12, x_max - 1, 0, 0);
-  WINDOW *process_window =
-      newwin(3 + n, x_max - 1, system_window->_maxy + 1, 0);
-  WINDOW *sim_sys_win =
-      newwin(7, x_max - 2, system_window->_maxy + process_window->_maxy + 2, 1);
-  WINDOW *sim_proc_win = newwin(
-      10, x_max - 2, system_window->_maxy + process_window->_maxy + 9, 1);
-  WINDOW *sim_out_win = newwin(
-      5, x_max - 2, system_window->_maxy + process_window->_maxy + 19, 1);
+  Windows windows;
+  Layout(windows, n);
+  bool show_footer{false};
+  bool grouped{false};
+  // Memory columns leaking processes first, network columns busiest
+  Columns columns{kCpuColumns_};
+  bool tree{false};
+  Power power;
+  bool show_power{true};
+  Sampler sampler;
+  // Process rules watch every process, not only those the filter shows
+  system.ScanAll(alerts != nullptr && alerts->Has(Alerts::kProcess_));
+  // The list of the last scan, scrolling redraws it without a rescan
+  std::vector<Process> *processes = nullptr;
+  std::vector<Cgroup> *cgroups = nullptr;
+  std::vector<ProcessTree::Row> const *rows = nullptr;
+  ListView process_view;
+  ListView cgroup_view;
+  int selected_pid{-1};
+  process_view.Resize(getmaxy(windows.processes) - 3);
+  cgroup_view.Resize(getmaxy(windows.processes) - 3);
 
   init_pair(1, COLOR_BLUE, COLOR_BLACK);
   init_pair(2, COLOR_GREEN, COLOR_BLACK);
+  init_pair(3, COLOR_RED, COLOR_BLACK);
 
   nodelay(stdscr, TRUE);
-  CompareScheduling(system, sim_out_win);
+  // Rows of the process list, flat or as a tree
+  auto list_size = [&]() -> size_t {
+    if (tree) {
+      return rows != nullptr ? rows->size() : 0;
+    }
+    return processes != nullptr ? processes->size() : 0;
+  };
+  auto pid_at = [&](size_t i) {
+    return tree ? (*rows)[i].process->Pid() : (*processes)[i].Pid();
+  };
+  auto draw_list = [&]() {
+    Instrumentation::ScopedTimer timer(Instrumentation::kRender_);
+    if (grouped && cgroups != nullptr) {
+      DisplayCgroups(*cgroups, windows.processes, cgroup_view);
+    } else if (tree && rows != nullptr) {
+      DisplayTree(*rows, windows.processes, process_view);
+    } else if (!tree && processes != nullptr) {
+      DisplayProcesses(*processes, windows.processes, process_view, columns);
+    }
+    if (!system.ProcessFilter().Text().empty()) {
+      mvwprintw(windows.processes, 0, 2, " filter: %s ",
+                system.ProcessFilter().Text().c_str());
+      wrefresh(windows.processes);
+    }
+  };
   while (true) {
-    box(system_window, 0, 0);
-    box(process_window, 0, 0);
-    box(sim_sys_win, 0, 0);
-    box(sim_proc_win, 0, 0);
-    box(sim_out_win, 0, 0);
+    box(windows.system, 0, 0);
+    box(windows.processes, 0, 0);
+    box(windows.sim_sys, 0, 0);
+    box(windows.sim_proc, 0, 0);
+    box(windows.sim_out, 0, 0);
 
-    DisplaySystem(system, system_window);
-    DisplayProcesses(system.Processes(), process_window, n);
+    // Only redraw the tiers that are due, see Sampler
+    auto now = Sampler::Clock::now();
+    double const seconds{
+        std::chrono::duration<double>(now.time_since_epoch()).count()};
+    bool const system_due{sampler.SystemDue(now)};
+    if (system_due) {
+      SystemSnapshot const snapshot = system.Snapshot();
+      {
+        Instrumentation::ScopedTimer timer(Instrumentation::kRender_);
+        werase(windows.system);
+        box(windows.system, 0, 0);
+        DisplaySystem(snapshot, windows.system);
+      }
+      if (show_power) {
+        power.Sample();
+        DisplayPower(power, windows.system);
+      }
+      system.Net().SampleInterfaces();
+      DisplayNetwork(system.Net(), windows.system);
+      float const pressure{LinuxParser::CpuPressure()};
+      sampler.ObserveSystem(system.Cpu().LastUtilization(), pressure);
+      if (alerts != nullptr) {
+        alerts->ObserveSystem(snapshot, pressure, seconds);
+      }
+    }
+    if (sampler.ProcessesDue(now)) {
+      processes = &system.Processes();
+      sampler.ObserveProcesses(*processes, n);
+      if (exporter != nullptr) {
+        exporter->Publish(system, *processes);
+      }
+      bool const watch_cgroups{alerts != nullptr &&
+                               alerts->Has(Alerts::kCgroup_)};
+      if (grouped || watch_cgroups) {
+        cgroups = &system.Cgroups();
+        cgroup_view.SetCount(cgroups->size());
+      }
+      if (alerts != nullptr) {
+        alerts->ObserveProcesses(system.AllProcesses(), seconds);
+        if (watch_cgroups) {
+          alerts->ObserveCgroups(*cgroups, seconds);
+        }
+      }
+      if (tree) {
+        rows = &system.Tree();
+      }
+      process_view.SetCount(list_size());
+      // Keep the selected process selected wherever the sort moved it
+      for (size_t i = 0; i < list_size(); ++i) {
+        if (pid_at(i) == selected_pid) {
+          process_view.Follow(i);
+          break;
+        }
+      }
+      draw_list();
+    }
+    if (alerts != nullptr && system_due) {
+      DisplayAlerts(*alerts, windows.system);
+    }
+    if (show_footer) {
+      werase(windows.footer);
+      box(windows.footer, 0, 0);
+      DisplayInstrumentation(windows.footer);
+    }
 
     int ch = getch();
+    if (ch == 'Q' || ch == 'q') {
+      break;
+    }
+    if (ch == KEY_RESIZE) {
+      // ncurses turns SIGWINCH into KEY_RESIZE and updates LINES/COLS
+      Layout(windows, n);
+      process_view.Resize(getmaxy(windows.processes) - 3);
+      cgroup_view.Resize(getmaxy(windows.processes) - 3);
+      clear();
+      refresh();
+      DisplaySystem(system, windows.system);
+      if (show_power) {
+        DisplayPower(power, windows.system);
+      }
+      DisplayNetwork(system.Net(), windows.system);
+      if (alerts != nullptr) {
+        DisplayAlerts(*alerts, windows.system);
+      }
+      draw_list();
+    }
+    if (Scroll(ch, grouped ? cgroup_view : process_view)) {
+      if (!grouped && list_size() > 0) {
+        selected_pid = pid_at(process_view.Selected());
+      }
+      draw_list();
+    }
+    if (ch == 'J' || ch == 'j') {
+      char input[32];
+      Prompt("Jump to PID: ", input, sizeof(input));
+      int const pid{std::atoi(input)};
+      bool found{false};
+      // Processes in collapsed subtrees are not in the list
+      for (size_t i = 0; i < list_size(); ++i) {
+        if (pid_at(i) == pid) {
+          grouped = false;
+          process_view.Select(i);
+          selected_pid = pid;
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        mvprintw(getmaxy(stdscr) - 1, 0, "No process %s in the list", input);
+      }
+      werase(windows.processes);
+      box(windows.processes, 0, 0);
+      draw_list();
+    }
+    if (ch == 'P' || ch == 'p') {
+      show_footer = !show_footer;
+      if (!show_footer) {
+        werase(windows.footer);
+        wrefresh(windows.footer);
+        touchwin(windows.sim_out);
+      }
+    }
+    if (ch == '/') {
+      // Read a filter expression on the last line, empty clears it
+      char input[256];
+      Prompt("Filter: ", input, sizeof(input));
+      try {
+        system.SetFilter(Filter(input));
+      } catch (std::invalid_argument const &e) {
+        mvprintw(getmaxy(stdscr) - 1, 0, "Filter error: %s", e.what());
+      }
+      werase(windows.processes);
+      box(windows.processes, 0, 0);
+      sampler.SpeedUp();
+    }
+    if (ch == 'G' || ch == 'g') {
+      grouped = !grouped;
+      tree = false;
+      cgroups = nullptr;
+      werase(windows.processes);
+      box(windows.processes, 0, 0);
+      sampler.SpeedUp();
+    }
+    if (ch == 'T' || ch == 't') {
+      tree = !tree;
+      grouped = false;
+      rows = nullptr;
+      werase(windows.processes);
+      box(windows.processes, 0, 0);
+      sampler.SpeedUp();
+    }
+    if ((ch == '\n' || ch == KEY_ENTER) && tree && list_size() > 0) {
+      // Collapse or expand the selected subtree without a rescan
+      selected_pid = pid_at(process_view.Selected());
+      system.ToggleSubtree(selected_pid);
+      rows = &system.Tree();
+      process_view.SetCount(list_size());
+      draw_list();
+    }
+    if (ch == 'M' || ch == 'm' || ch == 'N' || ch == 'n') {
+      Columns const chosen{ch == 'M' || ch == 'm' ? kMemoryColumns_
+                                                  : kNetworkColumns_};
+      columns = columns == chosen ? kCpuColumns_ : chosen;
+      System::Order const orders[] = {System::kByCpu_, System::kByGrowth_,
+                                      System::kByNetwork_};
+      system.SetOrder(orders[columns]);
+      // Sockets are only listed and attributed while they are shown
+      system.EnableSockets(columns == kNetworkColumns_);
+      werase(windows.processes);
+      box(windows.processes, 0, 0);
+      sampler.SpeedUp();
+    }
+    if (ch == 'E' || ch == 'e') {
+      // Applied at the next redraw of the system window
+      show_power = !show_power;
+    }
+    if (ch == 'C' || ch == 'c') {
+      CompareScheduling(system, windows.sim_out);
+    }
     if (ch == 'S' || ch == 's') {
-      SimulateScheduling(sim_sys_win, sim_proc_win, sim_out_win);
-      werase(sim_sys_win);
-      werase(sim_proc_win);
-      werase(sim_out_win);
-      wrefresh(sim_sys_win);
-      wrefresh(sim_proc_win);
-      wrefresh(sim_out_win);
+      SimulateScheduling(windows.sim_sys, windows.sim_proc, windows.sim_out);
+      werase(windows.sim_sys);
+      werase(windows.sim_proc);
+      werase(windows.sim_out);
+      wrefresh(windows.sim_sys);
+      wrefresh(windows.sim_proc);
+      wrefresh(windows.sim_out);
 
-      wrefresh(system_window);
-      wrefresh(process_window);
-      wrefresh(sim_sys_win);
-      wrefresh(sim_proc_win);
-      wrefresh(sim_out_win);
+      wrefresh(windows.system);
+      wrefresh(windows.processes);
+      wrefresh(windows.sim_sys);
+      wrefresh(windows.sim_proc);
+      wrefresh(windows.sim_out);
       refresh();
     }
 
-    wrefresh(system_window);
-    wrefresh(process_window);
-    wrefresh(sim_sys_win);
-    wrefresh(sim_proc_win);
-    wrefresh(sim_out_win);
+    wrefresh(windows.system);
+    wrefresh(windows.processes);
+    wrefresh(windows.sim_sys);
+    wrefresh(windows.sim_proc);
+    wrefresh(windows.sim_out);
     refresh();
 
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
 
   endwin();
+  if (!profile_path.empty() && !Instrumentation::Dump(profile_path)) {
+    std::cerr << "Could not write profile to " << profile_path << "\n";
+  }
+}
+
+// Viewer of one or more agents, Tab switches between them
+void NCursesDisplay::DisplayRemote(std::vector<std::string> const &addresses,
+                                   int n, Alerts *alerts) {
+  struct Remote {
+    std::string address;
+    int fd;
+    Protocol::Decoder decoder;
+    std::string buffer;
+  };
+  std::vector<std::unique_ptr<Remote>> remotes;
+  for (std::string const &address : addresses) {
+    remotes.push_back(std::unique_ptr<Remote>(
+        new Remote{address, Protocol::Connect(address), {}, {}}));
+  }
+
+  initscr();
+  noecho();
+  cbreak();
+  keypad(stdscr, TRUE);
+  start_color();
+  nodelay(stdscr, TRUE);
+  init_pair(1, COLOR_BLUE, COLOR_BLACK);
+  init_pair(2, COLOR_GREEN, COLOR_BLACK);
+  init_pair(3, COLOR_RED, COLOR_BLACK);
+
+  WINDOW *system_window = nullptr;
+  WINDOW *process_window = nullptr;
+  ListView view;
+  auto layout = [&]() {
+    if (system_window != nullptr) {
+      delwin(system_window);
+      delwin(process_window);
+    }
+    int const x_max{getmaxx(stdscr)};
+    system_window = ClippedWindow(12, x_max - 1, 0, 0);
+    process_window = ClippedWindow(
+        std::max(3 + n, getmaxy(stdscr) - 12), x_max - 1, 12, 0);
+    view.Resize(getmaxy(process_window) - 3);
+  };
+  layout();
+  size_t current{0};
+  bool dirty{true};
+  std::vector<pollfd> fds;
+  char chunk[65536];
+
+  while (true) {
+    fds.clear();
+    for (auto const &remote : remotes) {
+      fds.push_back({remote->fd, POLLIN, 0});
+    }
+    // Keys wake the loop too, scrolling does not wait for a frame
+    fds.push_back({STDIN_FILENO, POLLIN, 0});
+    poll(fds.data(), fds.size(), 100);
+    for (size_t i = 0; i < remotes.size(); ++i) {
+      Remote &remote = *remotes[i];
+      if (remote.fd < 0 || fds[i].revents == 0) {
+        continue;
+      }
+      ssize_t received = recv(remote.fd, chunk, sizeof(chunk), 0);
+      if (received > 0) {
+        remote.buffer.append(chunk, received);
+      }
+      if (received <= 0 || !remote.decoder.Consume(remote.buffer)) {
+        close(remote.fd);
+        remote.fd = -1;
+      } else if (alerts != nullptr && i == current) {
+        // Rules watch the agent on screen, the snapshot has no pressure
+        double const now{std::chrono::duration<double>(
+                             std::chrono::steady_clock::now()
+                                 .time_since_epoch())
+                             .count()};
+        alerts->ObserveSystem(remote.decoder.System(), 0.0, now);
+        alerts->ObserveProcesses(remote.decoder.Processes(), now);
+      }
+      dirty = dirty || i == current;
+    }
+
+    int ch = getch();
+    if (ch == 'Q' || ch == 'q') {
+      break;
+    }
+    if (ch == '\t') {
+      current = (current + 1) % remotes.size();
+      view.Home();
+      if (alerts != nullptr) {
+        alerts->Reset();
+      }
+      dirty = true;
+    }
+    if (ch == KEY_RESIZE) {
+      layout();
+      clear();
+      refresh();
+      dirty = true;
+    }
+    dirty = Scroll(ch, view) || dirty;
+    if (dirty) {
+      Remote &remote = *remotes[current];
+      werase(system_window);
+      werase(process_window);
+      box(system_window, 0, 0);
+      box(process_window, 0, 0);
+      DisplaySystem(remote.decoder.System(), system_window);
+      view.SetCount(remote.decoder.Processes().size());
+      DisplayProcesses(remote.decoder.Processes(), process_window, view);
+      mvwprintw(system_window, 0, 2, " [%zu/%zu] %s%s  last frame %zu B ",
+                current + 1, remotes.size(), remote.address.c_str(),
+                remote.fd < 0 ? " (disconnected)" : "",
+                remote.decoder.LastFrameBytes());
+      wrefresh(system_window);
+      if (alerts != nullptr) {
+        DisplayAlerts(*alerts, system_window);
+      }
+      dirty = false;
+    }
+  }
+
+  endwin();
+  for (auto const &remote : remotes) {
+    if (remote->fd >= 0) {
+      close(remote->fd);
+    }
+  }
 }
@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iterator>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "linux_parser.h"
+#include "network.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+// Socket states as the kernel numbers them (include/net/tcp_states.h)
+constexpr int kTcpEstablished{1};
+constexpr int kTcpTimeWait{6};
+constexpr int kTcpListen{10};
+
+Network::State StateOf(int state) {
+  switch (state) {
+  case kTcpEstablished:
+    return Network::kEstablished_;
+  case kTcpListen:
+    return Network::kListen_;
+  default:
+    return Network::kOther_;
+  }
+}
+
+double Now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Return the bytes per second between two readings of a counter
+double Rate(unsigned long long now, unsigned long long before,
+            double seconds) {
+  return now >= before && seconds > 0.0 ? (now - before) / seconds : 0.0;
+}
+} // namespace
+
+// Return the number of sockets in any state
+int Network::Sockets::Count() const {
+  int count{0};
+  for (int state : states) {
+    count += state;
+  }
+  return count;
+}
+
+Network::Network() : dev(4096), message(64 * 1024) {
+  diag_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+}
+
+Network::~Network() {
+  if (dev_fd >= 0) {
+    close(dev_fd);
+  }
+  if (diag_fd >= 0) {
+    close(diag_fd);
+  }
+}
+
+// Rereads the byte counters of every interface
+void Network::SampleInterfaces() {
+  int length;
+  while ((length = LinuxParser::ReadFile(dev_fd, "/proc/net/dev", dev.data(),
+                                         dev.size())) ==
+         static_cast<int>(dev.size()) - 1) {
+    dev.resize(dev.size() * 2);
+  }
+  if (length == 0) {
+    return;
+  }
+  const double now = Now();
+  const double seconds = interfaces_time > 0.0 ? now - interfaces_time : 0.0;
+  interfaces_time = now;
+  // Two header lines, then "<name>: <8 receive fields> <8 transmit fields>"
+  char *line = std::strchr(dev.data(), '\n');
+  line = line != nullptr ? std::strchr(line + 1, '\n') : nullptr;
+  size_t count{0};
+  while (line != nullptr && *++line != '\0') {
+    char *colon = std::strchr(line, ':');
+    char *end = std::strchr(line, '\n');
+    if (colon == nullptr || end == nullptr || colon > end) {
+      break;
+    }
+    while (*line == ' ') {
+      ++line;
+    }
+    char *cursor;
+    const unsigned long long rx = std::strtoull(colon + 1, &cursor, 10);
+    for (int field = 0; field < 7; ++field) {
+      std::strtoull(cursor, &cursor, 10);
+    }
+    const unsigned long long tx = std::strtoull(cursor, &cursor, 10);
+    if (count == interfaces.size()) {
+      interfaces.emplace_back();
+    }
+    Interface &interface = interfaces[count++];
+    // Interfaces keep their order unless one is added or removed
+    if (interface.name.compare(0, string::npos, line, colon - line) != 0) {
+      interface = Interface{string(line, colon), 0.0, 0.0, rx, tx};
+    }
+    interface.rx = Rate(rx, interface.rx_bytes, seconds);
+    interface.tx = Rate(tx, interface.tx_bytes, seconds);
+    interface.rx_bytes = rx;
+    interface.tx_bytes = tx;
+    line = end;
+  }
+  interfaces.resize(count);
+}
+
+// Return the interfaces with their throughput over the last interval
+vector<Network::Interface> const &Network::Interfaces() const {
+  return interfaces;
+}
+
+// Lists the sockets, finds the owners of new ones and sums them per
+// process; pids are the live processes
+void Network::SampleSockets(vector<int> const &pids) {
+  const double now = Now();
+  const double seconds = sockets_time > 0.0 ? now - sockets_time : 0.0;
+  sockets.clear();
+  if (diag_fd >= 0 &&
+      !(Dump(AF_INET, IPPROTO_TCP) && Dump(AF_INET6, IPPROTO_TCP) &&
+        Dump(AF_INET, IPPROTO_UDP) && Dump(AF_INET6, IPPROTO_UDP))) {
+    // Refused (old kernel, seccomp), fall back for good
+    close(diag_fd);
+    diag_fd = -1;
+    sockets.clear();
+  }
+  if (diag_fd < 0) {
+    for (const char *table : {"/proc/net/tcp", "/proc/net/tcp6",
+                              "/proc/net/udp", "/proc/net/udp6"}) {
+      ReadTable(table);
+    }
+  }
+  std::sort(sockets.begin(), sockets.end());
+  live.assign(pids.begin(), pids.end());
+  std::sort(live.begin(), live.end());
+
+  // Forget sockets that closed and owners that exited
+  auto closed = [this](unsigned long inode) {
+    return !std::binary_search(sockets.begin(), sockets.end(),
+                               Socket{inode, kOther_, 0, 0, 0});
+  };
+  for (auto it = owners.begin(); it != owners.end();) {
+    if (closed(it->first) ||
+        !std::binary_search(live.begin(), live.end(), it->second)) {
+      it = owners.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto it = orphans.begin(); it != orphans.end();) {
+    it = closed(*it) ? orphans.erase(it) : std::next(it);
+  }
+  for (auto it = pending.begin(); it != pending.end();) {
+    it = closed(it->first) ? pending.erase(it) : std::next(it);
+  }
+
+  // Only root may read the descriptors of other users' processes
+  const unsigned uid = geteuid();
+  long unknown{0};
+  for (Socket const &socket : sockets) {
+    if (!Unknown(socket.inode)) {
+      continue;
+    }
+    if (uid != 0 && socket.uid != uid) {
+      orphans.insert(socket.inode);
+      continue;
+    }
+    pending.emplace(socket.inode, steps);
+    ++unknown;
+  }
+  if (unknown > 0) {
+    // Cold: every table once, no budget
+    long budget = known.empty() ? static_cast<long>(live.size()) : kWalkBudget;
+    order.clear();
+    if (!known.empty()) {
+      // New processes, then those already holding sockets (servers
+      // accepting, clients reconnecting)
+      std::set_difference(live.begin(), live.end(), known.begin(),
+                          known.end(), std::back_inserter(order));
+      const size_t first = order.size();
+      for (auto const &owner : owners) {
+        order.push_back(owner.second);
+      }
+      std::sort(order.begin() + first, order.end());
+      order.erase(std::unique(order.begin() + first, order.end()),
+                  order.end());
+    }
+    for (size_t i = 0; i < order.size() && unknown > 0 && budget > 0;
+         ++i, --budget) {
+      unknown -= Walk(order[i]);
+    }
+    for (size_t i = 0; i < live.size() && unknown > 0 && budget > 0;
+         ++i, --budget) {
+      cursor = cursor < live.size() ? cursor : 0;
+      unknown -= Walk(live[cursor++]);
+      ++steps;
+    }
+    // Missed by a whole round of the round robin
+    for (auto it = pending.begin(); it != pending.end();) {
+      if (owners.count(it->first) != 0) {
+        it = pending.erase(it);
+      } else if (steps - it->second >= static_cast<long>(live.size())) {
+        orphans.insert(it->first);
+        it = pending.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  known.swap(live);
+
+  processes.clear();
+  next_bytes.clear();
+  for (Socket const &socket : sockets) {
+    double rx{0.0};
+    double tx{0.0};
+    if (socket.rx != 0 || socket.tx != 0) {
+      auto previous = bytes.find(socket.inode);
+      if (previous != bytes.end()) {
+        rx = Rate(socket.rx, previous->second.first, seconds);
+        tx = Rate(socket.tx, previous->second.second, seconds);
+      } else {
+        // Opened since the previous refresh
+        rx = Rate(socket.rx, 0, seconds);
+        tx = Rate(socket.tx, 0, seconds);
+      }
+      next_bytes.emplace(socket.inode, std::make_pair(socket.rx, socket.tx));
+    }
+    auto owner = owners.find(socket.inode);
+    if (owner == owners.end()) {
+      continue;
+    }
+    Sockets &sums = processes[owner->second];
+    ++sums.states[socket.state];
+    sums.rx += rx;
+    sums.tx += tx;
+  }
+  bytes.swap(next_bytes);
+  sockets_time = now;
+}
+
+// Return the sockets of a process at the last refresh
+Network::Sockets Network::Of(int pid) const {
+  auto found = processes.find(pid);
+  return found != processes.end() ? found->second : Sockets{};
+}
+
+// Return whether sockets are listed through sock_diag
+bool Network::Diag() const { return diag_fd >= 0; }
+
+// Return the number of descriptor tables read so far
+long Network::Walks() const { return walks; }
+
+// Appends the sockets of one family and protocol, false if the dump fails
+bool Network::Dump(int family, int protocol) {
+  struct {
+    nlmsghdr header;
+    inet_diag_req_v2 request;
+  } query;
+  std::memset(&query, 0, sizeof(query));
+  query.header.nlmsg_len = sizeof(query);
+  query.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  query.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  query.request.sdiag_family = family;
+  query.request.sdiag_protocol = protocol;
+  // TIME_WAIT sockets belong to no process
+  query.request.idiag_states = ~(1u << kTcpTimeWait);
+  if (protocol == IPPROTO_TCP) {
+    query.request.idiag_ext = 1 << (INET_DIAG_INFO - 1);
+  }
+  sockaddr_nl kernel;
+  std::memset(&kernel, 0, sizeof(kernel));
+  kernel.nl_family = AF_NETLINK;
+  if (sendto(diag_fd, &query, sizeof(query), 0,
+             reinterpret_cast<sockaddr *>(&kernel), sizeof(kernel)) < 0) {
+    return false;
+  }
+  while (true) {
+    int length = recv(diag_fd, message.data(), message.size(), 0);
+    if (length < 0 && errno == EINTR) {
+      continue;
+    }
+    if (length <= 0) {
+      return false;
+    }
+    for (auto *header = reinterpret_cast<nlmsghdr *>(message.data());
+         NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+      if (header->nlmsg_type == NLMSG_DONE) {
+        return true;
+      }
+      if (header->nlmsg_type == NLMSG_ERROR) {
+        return false;
+      }
+      auto *diag = static_cast<inet_diag_msg *>(NLMSG_DATA(header));
+      if (diag->idiag_inode == 0) {
+        continue;
+      }
+      Socket socket{diag->idiag_inode, StateOf(diag->idiag_state),
+                    diag->idiag_uid, 0, 0};
+      int attributes = header->nlmsg_len - NLMSG_LENGTH(sizeof(*diag));
+      for (auto *attribute = reinterpret_cast<rtattr *>(diag + 1);
+           RTA_OK(attribute, attributes);
+           attribute = RTA_NEXT(attribute, attributes)) {
+        if (attribute->rta_type != INET_DIAG_INFO) {
+          continue;
+        }
+        // Older kernels send a shorter tcp_info, missing fields stay 0
+        tcp_info info;
+        std::memset(&info, 0, sizeof(info));
+        std::memcpy(&info, RTA_DATA(attribute),
+                    std::min<size_t>(RTA_PAYLOAD(attribute), sizeof(info)));
+        socket.rx = info.tcpi_bytes_received;
+        socket.tx = info.tcpi_bytes_acked;
+      }
+      sockets.push_back(socket);
+    }
+  }
+}
+
+// Appends the sockets of a /proc/net table, without byte counters
+void Network::ReadTable(const char *path) {
+  FILE *file = std::fopen(path, "re");
+  if (file == nullptr) {
+    return;
+  }
+  char *line{nullptr};
+  size_t capacity{0};
+  // "sl local remote st tx:rx tr:when retransmits uid timeout inode ..."
+  while (getline(&line, &capacity, file) >= 0) {
+    int state;
+    unsigned uid;
+    unsigned long inode;
+    if (std::sscanf(line, " %*d: %*s %*s %x %*s %*s %*s %u %*u %lu", &state,
+                    &uid, &inode) == 3 &&
+        inode != 0) {
+      sockets.push_back(Socket{inode, StateOf(state), uid, 0, 0});
+    }
+  }
+  std::free(line);
+  std::fclose(file);
+}
+
+// Records the owner of every listed socket in the descriptor table of
+// pid, returns how many of them were unknown
+int Network::Walk(int pid) {
+  ++walks;
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+  int dir = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir < 0) {
+    return 0;
+  }
+  int found{0};
+  alignas(8) char buffer[16384];
+  long n;
+  while ((n = syscall(SYS_getdents64, dir, buffer, sizeof(buffer))) > 0) {
+    for (long offset = 0; offset < n;) {
+      auto *entry = reinterpret_cast<struct dirent64 *>(buffer + offset);
+      offset += entry->d_reclen;
+      if (entry->d_name[0] == '.') {
+        continue;
+      }
+      char link[64];
+      const ssize_t length =
+          readlinkat(dir, entry->d_name, link, sizeof(link) - 1);
+      if (length <= 8 || std::strncmp(link, "socket:[", 8) != 0) {
+        continue;
+      }
+      link[length] = '\0';
+      const unsigned long inode = std::strtoul(link + 8, nullptr, 10);
+      // Unix and netlink sockets are not listed, keep the cache small
+      if (!std::binary_search(sockets.begin(), sockets.end(),
+                              Socket{inode, kOther_, 0, 0, 0})) {
+        continue;
+      }
+      // A socket shared after fork stays with the first owner found
+      const bool unknown = Unknown(inode);
+      if (owners.emplace(inode, pid).second && unknown) {
+        ++found;
+      }
+      orphans.erase(inode);
+    }
+  }
+  close(dir);
+  return found;
+}
+
+// Return whether the owner of a socket is still to be found
+bool Network::Unknown(unsigned long inode) const {
+  return owners.count(inode) == 0 && orphans.count(inode) == 0;
+}
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "linux_parser.h"
+#include "power.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+// Returns the number in a small sysfs file read once, 0 if unreadable
+long long ReadNumber(string const &path) {
+  char buffer[64];
+  if (LinuxParser::ReadFile(path.c_str(), buffer, sizeof(buffer)) == 0) {
+    return 0;
+  }
+  return std::strtoll(buffer, nullptr, 10);
+}
+
+// Returns the names in a directory starting with prefix, sorted
+vector<string> Entries(string const &path, const char *prefix) {
+  vector<string> names;
+  DIR *dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return names;
+  }
+  while (dirent *entry = readdir(dir)) {
+    if (std::strncmp(entry->d_name, prefix, std::strlen(prefix)) == 0) {
+      names.emplace_back(entry->d_name);
+    }
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+} // namespace
+
+// Finds the cores with cpufreq and the readable RAPL zones once
+Power::Power(string const &sysfs) {
+  const string cpu_root = sysfs + "/devices/system/cpu/";
+  for (string const &name : Entries(cpu_root, "cpu")) {
+    int cpu;
+    char rest;
+    if (std::sscanf(name.c_str(), "cpu%d%c", &cpu, &rest) != 1) {
+      continue;
+    }
+    const string base = cpu_root + name + "/cpufreq/";
+    const long max_khz = ReadNumber(base + "cpuinfo_max_freq");
+    if (max_khz > 0) {
+      cores.push_back(Core{cpu, base + "scaling_cur_freq", -1, max_khz});
+    }
+  }
+  std::sort(cores.begin(), cores.end(),
+            [](Core const &a, Core const &b) { return a.cpu < b.cpu; });
+  // Only the cpu lines at the top of /proc/stat are needed
+  stat.resize((cores.size() + 2) * 160);
+
+  const string powercap = sysfs + "/class/powercap/";
+  for (string const &name : Entries(powercap, "intel-rapl:")) {
+    const string base = powercap + name + "/";
+    Counter counter{base + "energy_uj", -1,
+                    ReadNumber(base + "max_energy_range_uj")};
+    char buffer[64];
+    // Unreadable without privileges on most kernels since 5.10
+    if (LinuxParser::ReadFile(counter.fd, counter.path.c_str(), buffer,
+                              sizeof(buffer)) == 0) {
+      if (counter.fd >= 0) {
+        close(counter.fd);
+      }
+      continue;
+    }
+    counter.last = std::strtoll(buffer, nullptr, 10);
+    if (LinuxParser::ReadFile((base + "name").c_str(), buffer,
+                              sizeof(buffer)) == 0) {
+      std::strcpy(buffer, name.c_str());
+    }
+    buffer[std::strcspn(buffer, "\n")] = '\0';
+    counters.push_back(counter);
+    // intel-rapl:<package>[:<part>]
+    zones.push_back(Zone{buffer,
+                         static_cast<int>(std::count(name.begin(),
+                                                     name.end(), ':')) -
+                             1,
+                         0.0});
+  }
+  last_sample = std::chrono::steady_clock::now();
+}
+
+Power::~Power() {
+  for (Core const &core : cores) {
+    if (core.fd >= 0) {
+      close(core.fd);
+    }
+  }
+  for (Counter const &counter : counters) {
+    if (counter.fd >= 0) {
+      close(counter.fd);
+    }
+  }
+  if (stat_fd >= 0) {
+    close(stat_fd);
+  }
+}
+
+// Reads frequencies, per-core utilization and energy counters
+void Power::Sample() {
+  const auto now = std::chrono::steady_clock::now();
+  const double seconds =
+      std::chrono::duration<double>(now - last_sample).count();
+  last_sample = now;
+  SampleCores();
+  char buffer[64];
+  for (size_t i = 0; i < counters.size(); ++i) {
+    Counter &counter = counters[i];
+    if (LinuxParser::ReadFile(counter.fd, counter.path.c_str(), buffer,
+                              sizeof(buffer)) == 0) {
+      continue;
+    }
+    const long long microjoules = std::strtoll(buffer, nullptr, 10);
+    if (counter.last >= 0 && seconds > 0.0) {
+      long long used = microjoules - counter.last;
+      if (used < 0) {
+        used += counter.range;
+      }
+      zones[i].watts = used / 1e6 / seconds;
+    }
+    counter.last = microjoules;
+  }
+}
+
+void Power::SampleCores() {
+  if (cores.empty()) {
+    return;
+  }
+  char buffer[64];
+  for (Core &core : cores) {
+    if (LinuxParser::ReadFile(core.fd, core.path.c_str(), buffer,
+                              sizeof(buffer)) != 0) {
+      core.khz = std::strtol(buffer, nullptr, 10);
+    }
+  }
+  if (LinuxParser::ReadFile(
+          stat_fd,
+          (LinuxParser::kProcDirectory + LinuxParser::kStatFilename).c_str(),
+          stat.data(), stat.size()) == 0) {
+    return;
+  }
+  // Skip the aggregate line, then "cpu<N> user nice system idle iowait
+  // irq softirq steal ..." per online cpu, in cpu order like cores
+  char *cursor = std::strchr(stat.data(), '\n');
+  auto core = cores.begin();
+  while (cursor != nullptr && std::strncmp(++cursor, "cpu", 3) == 0) {
+    char *end = std::strchr(cursor, '\n');
+    if (end == nullptr) {
+      // Cut off by the buffer, cores past this line keep their last value
+      break;
+    }
+    const int cpu = std::strtol(cursor + 3, &cursor, 10);
+    long jiffies[LinuxParser::kGuest_];
+    for (long &value : jiffies) {
+      value = std::strtol(cursor, &cursor, 10);
+    }
+    cursor = end;
+    while (core != cores.end() && core->cpu < cpu) {
+      ++core;
+    }
+    if (core == cores.end() || core->cpu != cpu) {
+      continue;
+    }
+    const long idle = jiffies[LinuxParser::kIdle_] +
+                      jiffies[LinuxParser::kIOwait_];
+    long total{0};
+    for (long value : jiffies) {
+      total += value;
+    }
+    const long busy = total - idle;
+    if (core->total >= 0 && total > core->total) {
+      core->utilization =
+          static_cast<float>(busy - core->busy) / (total - core->total);
+    }
+    core->busy = busy;
+    core->total = total;
+  }
+}
+
+// Return whether any core reports its frequency
+bool Power::HasFrequency() const { return !cores.empty(); }
+
+// Return the mean current frequency of the cores in MHz
+float Power::Frequency() const {
+  double sum{0.0};
+  for (Core const &core : cores) {
+    sum += core.khz;
+  }
+  return cores.empty() ? 0.0 : sum / cores.size() / 1000;
+}
+
+// Return the mean maximum frequency of the cores in MHz
+float Power::MaxFrequency() const {
+  double sum{0.0};
+  for (Core const &core : cores) {
+    sum += core.max_khz;
+  }
+  return cores.empty() ? 0.0 : sum / cores.size() / 1000;
+}
+
+// Return the share of the full-speed capacity used: each core's busy
+// share scaled by its current over its maximum frequency
+float Power::WeightedUtilization() const {
+  double sum{0.0};
+  for (Core const &core : cores) {
+    sum += core.utilization * core.khz / core.max_khz;
+  }
+  return cores.empty() ? 0.0 : sum / cores.size();
+}
+
+// Return the energy zones with their power over the last interval
+vector<Power::Zone> const &Power::Zones() const { return zones; }
@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "proc_reader.h"
+
+namespace {
+const char *const kNames[] = {"stat", "status", "io"};
+// Buffer sizes, stat and io are short, status is about 1.5 kB
+constexpr int kSizes[] = {1024, 4096, 256};
+constexpr int kOffsets[] = {0, kSizes[0], kSizes[0] + kSizes[1]};
+constexpr int kBlock{kSizes[0] + kSizes[1] + kSizes[2]};
+constexpr int kUnread{-2};
+// Open, read and close per file
+constexpr int kOps{3};
+constexpr int kSlots{ProcReader::kBatch * ProcReader::kFileCount_};
+} // namespace
+
+// The mapped submission and completion rings
+struct ProcReader::Ring {
+  ~Ring() {
+    if (sqes != nullptr) {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ring != nullptr && cq_ring != sq_ring) {
+      munmap(cq_ring, cq_size);
+    }
+    if (sq_ring != nullptr) {
+      munmap(sq_ring, sq_size);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  // Returns a mapping of the ring, nullptr on failure
+  void *Map(size_t size, off_t offset) {
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, offset);
+    return address == MAP_FAILED ? nullptr : address;
+  }
+
+  int fd{-1};
+  void *sq_ring{nullptr};
+  void *cq_ring{nullptr};
+  size_t sq_size{0};
+  size_t cq_size{0};
+  io_uring_sqe *sqes{nullptr};
+  size_t sqes_size{0};
+  unsigned *sq_tail{nullptr};
+  unsigned *sq_mask{nullptr};
+  unsigned *sq_array{nullptr};
+  unsigned *cq_head{nullptr};
+  unsigned *cq_tail{nullptr};
+  unsigned *cq_mask{nullptr};
+  io_uring_cqe *cqes{nullptr};
+  // Paths must stay valid until their opens are submitted
+  char paths[kSlots][32];
+};
+
+ProcReader::ProcReader() : buffers(kBatch * kBlock) {}
+
+ProcReader::~ProcReader() = default;
+
+// Switches to the io_uring backend, returns false if it is unavailable
+bool ProcReader::EnableUring() {
+  if (ring) {
+    return true;
+  }
+  auto created = std::make_unique<Ring>();
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  // A failed open must not stop the rest of the batch from being submitted
+  params.flags = IORING_SETUP_SUBMIT_ALL;
+  created->fd = syscall(__NR_io_uring_setup, kSlots * kOps, &params);
+  if (created->fd < 0) {
+    return false;
+  }
+  created->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  created->cq_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    created->sq_size = created->cq_size =
+        std::max(created->sq_size, created->cq_size);
+  }
+  created->sq_ring = created->Map(created->sq_size, IORING_OFF_SQ_RING);
+  if (created->sq_ring == nullptr) {
+    return false;
+  }
+  created->cq_ring = params.features & IORING_FEAT_SINGLE_MMAP
+                         ? created->sq_ring
+                         : created->Map(created->cq_size, IORING_OFF_CQ_RING);
+  created->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  created->sqes = static_cast<io_uring_sqe *>(
+      created->Map(created->sqes_size, IORING_OFF_SQES));
+  if (created->cq_ring == nullptr || created->sqes == nullptr) {
+    return false;
+  }
+  // Empty slots for the direct descriptors of one batch
+  io_uring_rsrc_register files;
+  std::memset(&files, 0, sizeof(files));
+  files.nr = kSlots;
+  files.flags = IORING_RSRC_REGISTER_SPARSE;
+  if (syscall(__NR_io_uring_register, created->fd, IORING_REGISTER_FILES2,
+              &files, sizeof(files)) < 0) {
+    return false;
+  }
+
+  char *sq = static_cast<char *>(created->sq_ring);
+  char *cq = static_cast<char *>(created->cq_ring);
+  created->sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  created->sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  created->sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  created->cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  created->cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  created->cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  created->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  // Entries are always submitted in order
+  for (unsigned i = 0; i < params.sq_entries; ++i) {
+    created->sq_array[i] = i;
+  }
+  ring = std::move(created);
+  return true;
+}
+
+// Return whether reads go through io_uring
+bool ProcReader::Uring() const { return ring != nullptr; }
+
+// Starts reading the files of count (at most kBatch) processes, pids must
+// outlive the calls to Contents. The synchronous backend reads on demand.
+void ProcReader::Read(int const *pids, int count) {
+  this->pids = pids;
+  lengths.assign(count * kFileCount_, kUnread);
+  if (!ring) {
+    return;
+  }
+  unsigned tail = *ring->sq_tail;
+  auto next = [&]() {
+    io_uring_sqe *sqe = &ring->sqes[tail++ & *ring->sq_mask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  };
+  for (int i = 0; i < count; ++i) {
+    for (int file = 0; file < kFileCount_; ++file) {
+      const int slot = i * kFileCount_ + file;
+      std::snprintf(ring->paths[slot], sizeof(ring->paths[slot]),
+                    "/proc/%d/%s", pids[i], kNames[file]);
+      // A failed open cancels the read, the close runs whatever happens
+      io_uring_sqe *sqe = next();
+      sqe->opcode = IORING_OP_OPENAT;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = reinterpret_cast<uintptr_t>(ring->paths[slot]);
+      // Direct descriptors are never inherited, O_CLOEXEC is refused
+      sqe->open_flags = O_RDONLY;
+      sqe->file_index = slot + 1;
+      sqe->flags = IOSQE_IO_LINK;
+      sqe->user_data = slot * kOps;
+
+      sqe = next();
+      sqe->opcode = IORING_OP_READ;
+      sqe->fd = slot;
+      sqe->addr = reinterpret_cast<uintptr_t>(Buffer(i, File(file)));
+      sqe->len = kSizes[file] - 1;
+      sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+      sqe->user_data = slot * kOps + 1;
+
+      sqe = next();
+      sqe->opcode = IORING_OP_CLOSE;
+      sqe->file_index = slot + 1;
+      sqe->user_data = slot * kOps + 2;
+    }
+  }
+  __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+  // Usually a single enter submits everything and waits for it
+  const int total = count * kFileCount_ * kOps;
+  int submitted{0};
+  int completed{0};
+  while (completed < total) {
+    const int result =
+        syscall(__NR_io_uring_enter, ring->fd, total - submitted,
+                total - completed, IORING_ENTER_GETEVENTS, nullptr, 0);
+    ++syscalls;
+    if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      Abandon();
+      return;
+    }
+    submitted += std::max(result, 0);
+    unsigned head = *ring->cq_head;
+    const unsigned end = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != end; ++head, ++completed) {
+      io_uring_cqe const &cqe = ring->cqes[head & *ring->cq_mask];
+      if (cqe.user_data % kOps != 1) {
+        continue;
+      }
+      const size_t slot = cqe.user_data / kOps;
+      if (slot >= lengths.size()) {
+        continue;
+      }
+      lengths[slot] = cqe.res > 0 ? cqe.res : -1;
+      if (cqe.res > 0) {
+        Buffer(slot / kFileCount_, File(slot % kFileCount_))[cqe.res] = '\0';
+      }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+}
+
+// Drops the ring after io_uring_enter failed, reads are synchronous from
+// then on. Operations still queued or in flight may write into the
+// buffers later, so those are never used again and this batch is lost.
+void ProcReader::Abandon() {
+  ring.reset();
+  retired = std::move(buffers);
+  buffers.assign(kBatch * kBlock, '\0');
+  lengths.assign(lengths.size(), -1);
+}
+
+// Returns the contents of a file of the i-th process of the last Read,
+// nullptr if it could not be read
+const char *ProcReader::Contents(int i, File file) {
+  int &length = lengths[i * kFileCount_ + file];
+  if (length == kUnread) {
+    char path[32];
+    std::snprintf(path, sizeof(path), "/proc/%d/%s", pids[i], kNames[file]);
+    char *buffer = Buffer(i, file);
+    ++syscalls;
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    length = -1;
+    if (fd >= 0) {
+      // Proc files are generated whole, one read returns all of it
+      const ssize_t n = read(fd, buffer, kSizes[file] - 1);
+      close(fd);
+      syscalls += 2;
+      if (n > 0) {
+        buffer[n] = '\0';
+        length = n;
+      }
+    }
+  }
+  return length > 0 ? Buffer(i, file) : nullptr;
+}
+
+// Return the number of syscalls the reader has issued
+long ProcReader::Syscalls() const { return syscalls; }
+
+char *ProcReader::Buffer(int i, File file) {
+  return &buffers[i * kBlock + kOffsets[file]];
+}
@@ -1,65 +1,174 @@
-#include <cctype>
-#include <sstream>
-#include <string>
+#include <algorithm>
+#include <string_view>
 #include <unistd.h>
-#include <vector>
 
 #include "linux_parser.h"
 #include "process.h"
 
-using std::string;
-using std::to_string;
-using std::vector;
+using std::string_view;
+
+// Seconds between footprint samples, the trend spans 32 of them
+constexpr double kTrendSpacing{5.0};
+// Growth in MB per minute, over at least this many samples, that marks a
+// process as growing
+constexpr double kGrowingRate{1.0};
+constexpr int kGrowingSamples{8};
 
 // Constructor
-Process::Process(int PID) {
-  this->pid = PID;
-  updateCpuUtilization();
-}
+Process::Process(int PID) { this->pid = PID; }
 
 // Return this process's ID
 int Process::Pid() const { return this->pid; }
 
+// Return the ID of the parent process
+int Process::Ppid() const { return ppid; }
+
 // Return this process's CPU utilization
 float Process::getCpuUtilization() const { return cpu_utilization; }
 
-void Process::updateCpuUtilization() {
-  // Get raw data
-  vector<string> cpu_usage = LinuxParser::ProcessCpuUtilization(this->pid);
-  const long int utime = std::stol(cpu_usage[0]);
-  const long int stime = std::stol(cpu_usage[1]);
-  const long int cutime = std::stol(cpu_usage[2]);
-  const long int cstime = std::stol(cpu_usage[3]);
-  const long int starttime = std::stol(cpu_usage[4]);
-  const long int systime = LinuxParser::UpTime();
-
-  // Calculate cpu ustilization
-  const float TOTAL_TIME =
-      (utime + stime + cutime + cstime) / sysconf(_SC_CLK_TCK);
-  const float ELAPSED_TIME = systime - (starttime / sysconf(_SC_CLK_TCK));
-  if (ELAPSED_TIME == 0.0) {
-    cpu_utilization = 0.0;
+// Refresh from freshly read stat, status and io fields
+void Process::Update(LinuxParser::ProcessStat const &stat,
+                     LinuxParser::ProcessStatus const &status,
+                     LinuxParser::ProcessIo const &io, long uptime,
+                     double now) {
+  static const long HZ = sysconf(_SC_CLK_TCK);
+  const long int jiffies = stat.utime + stat.stime;
+  if (stat.starttime != start_time) {
+    // A new process behind a reused pid, forget the old one
+    start_time = stat.starttime;
+    prev_jiffies = -1;
+    footprint = {};
+    memory = {};
+    comm = {};
+  } else if (stat.startcode != start_code) {
+    // Same process, new program: read its command line again
+    comm = {};
+  }
+  start_code = stat.startcode;
+
+  this->status = stat.state;
+  ppid = stat.ppid;
+  arrival_time = stat.starttime / HZ;
+  burst_time = jiffies / HZ;
+  up_time = uptime - arrival_time;
+  resident = status.vm_rss;
+  ram = resident / 1024;
+  if (footprint.Count() == 0 || now - footprint.LastTime() >= kTrendSpacing) {
+    footprint.Add(now, status.vm_rss + status.vm_swap);
+  }
+  nice = stat.nice;
+  const long int io_bytes = io.read_bytes + io.write_bytes;
+
+  if (prev_jiffies == -1 || now <= prev_now) {
+    // First sight: average over the lifetime of the process
+    cpu_utilization =
+        up_time > 0 ? static_cast<float>(jiffies) / HZ / up_time : 0.0;
+    cpu_delta = 0;
+    io_rate = 0.0;
+    switch_rate = 0.0;
   } else {
-    cpu_utilization = TOTAL_TIME / ELAPSED_TIME;
+    // Otherwise: share of the interval since the previous update
+    cpu_utilization =
+        static_cast<float>(jiffies - prev_jiffies) / HZ / (now - prev_now);
+    cpu_delta = (jiffies - prev_jiffies) * 1000 / HZ;
+    io_rate = std::max(0L, io_bytes - prev_io) / (now - prev_now);
+    switch_rate = std::max(0L, status.context_switches - prev_switches) /
+                  (now - prev_now);
   }
+  prev_jiffies = jiffies;
+  prev_io = io_bytes;
+  prev_switches = status.context_switches;
+  prev_now = now;
+}
+
+// Set the fields of a record received from an agent, see Protocol
+void Process::Restore(char status, float cpu_utilization, long int ram,
+                      long int arrival_time, long int burst_time,
+                      long int up_time) {
+  this->status = status;
+  this->cpu_utilization = cpu_utilization;
+  this->ram = ram;
+  this->arrival_time = arrival_time;
+  this->burst_time = burst_time;
+  this->up_time = up_time;
 }
 
+// Return the short name (comm) of the process
+string_view Process::Comm() const { return comm; }
+
+// Return the cgroup v2 path of the process
+string_view Process::Cgroup() const { return cgroup; }
+
+// Return the time (seconds after boot) this process started
+long int Process::ArrivalTime() const { return arrival_time; }
+
+// Return the CPU time (in seconds) this process has used
+long int Process::BurstTime() const { return burst_time; }
+
+// Live processes have no known remaining burst
+long int Process::RemainingTime() const { return 0; }
+
+// Return the scheduler state of this process
+char Process::Status() const { return status; }
+
 // Return the command that generated this process
-string Process::Command() { return LinuxParser::Command(this->pid); }
+string_view Process::Command() const { return command; }
 
-// Return this process's memory utilization
-string Process::Ram() { return LinuxParser::Ram(this->pid); }
+// Return the resident memory of the process (in MB)
+long int Process::Ram() const { return ram; }
+
+// Return the resident memory of the process in kB
+long int Process::Resident() const { return resident; }
 
 // Return the user (name) that generated this process
-string Process::User() { return LinuxParser::User(this->pid); }
+string_view Process::User() const { return user; }
 
 // Return the age of this process (in seconds)
-long int Process::UpTime() {
-  // std::cout << LinuxParser::UpTime(this->pid) << std::endl;
-  return LinuxParser::UpTime(this->pid);
+long int Process::UpTime() const { return up_time; }
+
+// Return the nice value of the process
+int Process::Nice() const { return nice; }
+
+// Return the CPU time in ms used since the previous update
+long int Process::CpuDelta() const { return cpu_delta; }
+
+// Return the bytes per second read and written from storage
+double Process::IoRate() const { return io_rate; }
+
+// Return the context switches per second since the previous update
+double Process::SwitchRate() const { return switch_rate; }
+
+// Return how fast resident plus swapped memory grows, in MB per minute
+double Process::Growth() const { return footprint.Slope() * 60 / 1024; }
+
+// Return whether memory grew steadily over the recent samples
+bool Process::Growing() const {
+  return footprint.Count() >= kGrowingSamples && Growth() >= kGrowingRate;
+}
+
+// Return the smaps_rollup detail, all zero unless recently read
+LinuxParser::ProcessMemory const &Process::Memory() const { return memory; }
+
+void Process::SetMemory(LinuxParser::ProcessMemory const &memory) {
+  this->memory = memory;
 }
 
+// Return the TCP and UDP sockets of the process at the last refresh
+Network::Sockets const &Process::Sockets() const { return sockets; }
+
+void Process::SetSockets(Network::Sockets const &sockets) {
+  this->sockets = sockets;
+}
+
+void Process::SetComm(string_view comm) { this->comm = comm; }
+
+void Process::SetCommand(string_view command) { this->command = command; }
+
+void Process::SetUser(string_view user) { this->user = user; }
+
+void Process::SetCgroup(string_view cgroup) { this->cgroup = cgroup; }
+
 // Overload the "less than" comparison operator for Process objects
 bool Process::operator<(Process const &a) const {
   return getCpuUtilization() < a.getCpuUtilization();
-}
\ No newline at end of file
+}
@@ -0,0 +1,180 @@
+#include <climits>
+
+#include "process_tree.h"
+
+using std::vector;
+
+// The sentinel root, parent of the processes whose parent is not scanned
+ProcessTree::ProcessTree() { nodes[0].parent = -1; }
+
+// Adds a scanned process, or moves it if its parent changed
+void ProcessTree::Update(int pid, int ppid) {
+  auto found = nodes.find(pid);
+  if (found != nodes.end()) {
+    Node &node = found->second;
+    if (node.ppid == ppid) {
+      return;
+    }
+    // Orphans are adopted by init or a subreaper
+    StopWaiting(pid, node);
+    Unlink(node);
+    node.ppid = ppid;
+    Link(pid, node, ppid != pid && nodes.count(ppid) != 0 ? ppid : 0);
+    Wait(pid, node);
+    return;
+  }
+  Node &node = nodes[pid];
+  node.ppid = ppid;
+  Link(pid, node, ppid != pid && nodes.count(ppid) != 0 ? ppid : 0);
+  Wait(pid, node);
+  // Children scanned before their parent waited under the root
+  const auto children = waiting.equal_range(pid);
+  for (auto child = children.first; child != children.second; ++child) {
+    Node &orphan = nodes[child->second];
+    Unlink(orphan);
+    Link(child->second, orphan, pid);
+  }
+  waiting.erase(children.first, children.second);
+}
+
+// Drops a process that exited or is no longer scanned
+void ProcessTree::Remove(int pid) {
+  auto found = nodes.find(pid);
+  if (pid == 0 || found == nodes.end()) {
+    return;
+  }
+  Node &node = found->second;
+  // Children wait under the root until a scan shows their new parent
+  for (int child = node.first_child; child != -1;) {
+    Node &orphan = nodes[child];
+    const int next = orphan.next;
+    Unlink(orphan);
+    Link(child, orphan, 0);
+    Wait(child, orphan);
+    child = next;
+  }
+  StopWaiting(pid, node);
+  Unlink(node);
+  nodes.erase(found);
+}
+
+// Collapses or expands the subtree of a process
+void ProcessTree::Toggle(int pid) {
+  auto found = nodes.find(pid);
+  if (pid != 0 && found != nodes.end()) {
+    found->second.collapsed = !found->second.collapsed;
+  }
+}
+
+// Returns the number of processes in the tree
+size_t ProcessTree::Size() const { return nodes.size() - 1; }
+
+// Returns the visible rows in depth-first order with subtree totals,
+// records are the scanned processes the tree was updated with
+vector<ProcessTree::Row> const &
+ProcessTree::Flatten(vector<Process> const &records) {
+  // Records move on every sort, only the slots are refreshed per scan
+  for (size_t i = 0; i < records.size(); ++i) {
+    auto found = nodes.find(records[i].Pid());
+    if (found != nodes.end()) {
+      found->second.slot = i;
+    }
+  }
+
+  order.clear();
+  stack.clear();
+  if (nodes[0].first_child != -1) {
+    stack.emplace_back(nodes[0].first_child, -1);
+  }
+  while (!stack.empty()) {
+    const auto [pid, parent] = stack.back();
+    stack.pop_back();
+    Node const &node = nodes[pid];
+    // The sibling after the subtree, the subtree first
+    if (node.next != -1) {
+      stack.emplace_back(node.next, parent);
+    }
+    const bool known = node.slot >= 0 &&
+                       node.slot < static_cast<int>(records.size()) &&
+                       records[node.slot].Pid() == pid;
+    order.push_back(Entry{
+        known ? node.slot : -1,
+        parent == -1 ? 0 : order[parent].depth + 1, parent,
+        node.first_child != -1, node.collapsed,
+        known ? records[node.slot].getCpuUtilization() : 0.0f,
+        known ? records[node.slot].Ram() : 0});
+    if (node.first_child != -1) {
+      stack.emplace_back(node.first_child, order.size() - 1);
+    }
+  }
+  // Children come after their parent, so one backward pass sums subtrees
+  for (size_t i = order.size(); i-- > 0;) {
+    if (order[i].parent >= 0) {
+      order[order[i].parent].cpu += order[i].cpu;
+      order[order[i].parent].ram += order[i].ram;
+    }
+  }
+
+  rows.clear();
+  int hidden{INT_MAX};
+  for (Entry const &entry : order) {
+    if (entry.depth > hidden) {
+      continue;
+    }
+    hidden = entry.collapsed ? entry.depth : INT_MAX;
+    if (entry.slot >= 0) {
+      rows.push_back(Row{&records[entry.slot], entry.depth, entry.children,
+                         entry.collapsed, entry.cpu, entry.ram});
+    }
+  }
+  return rows;
+}
+
+void ProcessTree::Link(int pid, Node &node, int parent) {
+  Node &owner = nodes[parent];
+  node.parent = parent;
+  node.prev = owner.last_child;
+  node.next = -1;
+  if (owner.last_child != -1) {
+    nodes[owner.last_child].next = pid;
+  } else {
+    owner.first_child = pid;
+  }
+  owner.last_child = pid;
+}
+
+void ProcessTree::Unlink(Node &node) {
+  Node &owner = nodes[node.parent];
+  if (node.prev != -1) {
+    nodes[node.prev].next = node.next;
+  } else {
+    owner.first_child = node.next;
+  }
+  if (node.next != -1) {
+    nodes[node.next].prev = node.prev;
+  } else {
+    owner.last_child = node.prev;
+  }
+  node.prev = -1;
+  node.next = -1;
+}
+
+// Records a root that names a parent not scanned yet
+void ProcessTree::Wait(int pid, Node const &node) {
+  if (node.parent == 0 && node.ppid != 0 && node.ppid != pid) {
+    waiting.emplace(node.ppid, pid);
+  }
+}
+
+void ProcessTree::StopWaiting(int pid, Node const &node) {
+  if (node.parent != 0) {
+    return;
+  }
+  const auto siblings = waiting.equal_range(node.ppid);
+  for (auto sibling = siblings.first; sibling != siblings.second; ++sibling) {
+    if (sibling->second == pid) {
+      waiting.erase(sibling);
+      return;
+    }
+  }
+}
@@ -1,23 +1,19 @@
 #include "processor.h"
 #include "linux_parser.h"
 
-#include <string>
-#include <vector>
-
-using std::string;
-using std::vector;
+#include <array>
 
 // Returns the aggregate CPU utilization
 float Processor::Utilization() {
-  vector<string> cpu_usage = LinuxParser::CpuUtilization();
-  const long int usertime = std::stol(cpu_usage[0]);
-  const long int nicetime = std::stol(cpu_usage[1]);
-  const long int systemtime = std::stol(cpu_usage[2]);
-  const long int idletime = std::stol(cpu_usage[3]);
-  const long int iowait = std::stol(cpu_usage[4]);
-  const long int irq = std::stol(cpu_usage[5]);
-  const long int softirq = std::stol(cpu_usage[6]);
-  const long int steal = std::stol(cpu_usage[7]);
+  const auto cpu_usage = LinuxParser::CpuUtilization();
+  const long int usertime = cpu_usage[LinuxParser::kUser_];
+  const long int nicetime = cpu_usage[LinuxParser::kNice_];
+  const long int systemtime = cpu_usage[LinuxParser::kSystem_];
+  const long int idletime = cpu_usage[LinuxParser::kIdle_];
+  const long int iowait = cpu_usage[LinuxParser::kIOwait_];
+  const long int irq = cpu_usage[LinuxParser::kIRQ_];
+  const long int softirq = cpu_usage[LinuxParser::kSoftIRQ_];
+  const long int steal = cpu_usage[LinuxParser::kSteal_];
 
   // Calculate needed jiffy values (current state)
   const float IDLE = idletime + iowait;
@@ -40,9 +36,9 @@ float Processor::Utilization() {
 
     // calculate percentage of CPU usage
     if (TOTAL == 0.0) {
-      return 0.0;
+      return utilization = 0.0;
     }
-    return (TOTAL - IDLE) / TOTAL;
+    return utilization = (TOTAL - IDLE) / TOTAL;
   } else {
     // Calculate needed jiffy values (previous state)
     const long int PREV_IDLE = previdle + previowait;
@@ -66,9 +62,12 @@ float Processor::Utilization() {
 
     // calculate percentage of CPU usage
     if (TOTAL_DIF == 0.0) {
-      return 0.0;
+      return utilization = 0.0;
     }
-    return (TOTAL_DIF - IDLE_DIF) / TOTAL_DIF;
+    return utilization = (TOTAL_DIF - IDLE_DIF) / TOTAL_DIF;
   }
   return 0.0;
-}
\ No newline at end of file
+}
+
+// Returns the utilization computed by the last call to Utilization()
+float Processor::LastUtilization() const { return utilization; }
@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <netdb.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "protocol.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace {
+enum FrameType : uint8_t { kKeyframe = 0, kDelta = 1, kReset = 2 };
+
+// Changed-field mask of an upserted row
+enum Field : uint8_t {
+  kStatus = 1 << 0,
+  kCpu = 1 << 1,
+  kRam = 1 << 2,
+  kArrival = 1 << 3,
+  kBurst = 1 << 4,
+  kUser = 1 << 5,
+  kCommand = 1 << 6,
+  kAll = 0x7f
+};
+
+void PutVarint(string &out, unsigned long value) {
+  while (value >= 0x80) {
+    out += static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+void PutString(string &out, string_view value) {
+  PutVarint(out, value.size());
+  out.append(value.data(), value.size());
+}
+
+bool GetVarint(const char *&cursor, const char *end, unsigned long &value) {
+  value = 0;
+  for (int shift = 0; cursor < end && shift < 64; shift += 7) {
+    unsigned char byte = *cursor++;
+    value |= static_cast<unsigned long>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GetString(const char *&cursor, const char *end, string_view &value) {
+  unsigned long length;
+  if (!GetVarint(cursor, end, length) ||
+      length > static_cast<unsigned long>(end - cursor)) {
+    return false;
+  }
+  value = string_view(cursor, length);
+  cursor += length;
+  return true;
+}
+
+// Splits "<host>:<port>", throws if there is no port
+void SplitHostPort(string const &address, string &host, string &port) {
+  size_t colon = address.rfind(':');
+  if (colon == string::npos) {
+    throw std::runtime_error("expected <host>:<port> or unix:<path>, got " +
+                             address);
+  }
+  host = address.substr(0, colon);
+  port = address.substr(colon + 1);
+}
+
+// Opens a socket for address and binds or connects it
+int Open(string const &address, bool listening) {
+  if (address.compare(0, 5, "unix:") == 0) {
+    sockaddr_un local{};
+    local.sun_family = AF_UNIX;
+    string path = address.substr(5);
+    if (path.size() >= sizeof(local.sun_path)) {
+      throw std::runtime_error("socket path too long: " + path);
+    }
+    std::strcpy(local.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listening) {
+      // A socket left behind by a previous agent
+      unlink(path.c_str());
+    }
+    int result =
+        listening
+            ? bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local))
+            : connect(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local));
+    if (fd < 0 || result != 0 || (listening && listen(fd, 16) != 0)) {
+      string error = std::strerror(errno);
+      close(fd);
+      throw std::runtime_error(address + ": " + error);
+    }
+    return fd;
+  }
+
+  string host, port;
+  SplitHostPort(address, host, port);
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = listening ? AI_PASSIVE : 0;
+  addrinfo *results;
+  int status = getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                           port.c_str(), &hints, &results);
+  if (status != 0) {
+    throw std::runtime_error(address + ": " + gai_strerror(status));
+  }
+  string error = "no address";
+  for (addrinfo *info = results; info != nullptr; info = info->ai_next) {
+    int fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC,
+                    info->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    int on{1};
+    if (listening) {
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if (listening ? bind(fd, info->ai_addr, info->ai_addrlen) == 0 &&
+                        listen(fd, 16) == 0
+                  : connect(fd, info->ai_addr, info->ai_addrlen) == 0) {
+      freeaddrinfo(results);
+      return fd;
+    }
+    error = std::strerror(errno);
+    close(fd);
+  }
+  freeaddrinfo(results);
+  throw std::runtime_error(address + ": " + error);
+}
+} // namespace
+
+// Returns a listening socket for address
+int Protocol::Listen(string const &address) { return Open(address, true); }
+
+// Returns a socket connected to address
+int Protocol::Connect(string const &address) { return Open(address, false); }
+
+// Encodes the difference to the previous frame of this connection
+void Protocol::Encoder::Encode(SystemSnapshot const &system,
+                               vector<Process> const &processes,
+                               string &frame) {
+  // Strings seen for the first time are defined ahead of the rows
+  definitions_.clear();
+  new_strings_ = 0;
+  reset_ = keyframe_sent_ && pool_.Bytes() > kMaxStringBytes;
+  if (reset_) {
+    // Keys point into the pool, drop them first
+    strings_.clear();
+    pool_ = StringPool();
+  }
+
+  current_.clear();
+  for (Process const &process : processes) {
+    current_.push_back(
+        {process.Pid(), process.Status(),
+         static_cast<uint32_t>(std::lround(process.getCpuUtilization() * 1e4)),
+         process.Ram(), process.ArrivalTime(), process.BurstTime(),
+         StringId(process.User(), definitions_),
+         StringId(process.Command(), definitions_)});
+  }
+  std::sort(current_.begin(), current_.end(),
+            [](Row const &a, Row const &b) { return a.pid < b.pid; });
+
+  // Merge with the previous rows, both sorted by pid
+  removed_.clear();
+  upserted_.clear();
+  int removed_count{0}, upserted_count{0};
+  int last_removed{0}, last_upserted{0};
+  auto previous = previous_.begin();
+  for (Row const &row : current_) {
+    for (; previous != previous_.end() && previous->pid < row.pid;
+         ++previous) {
+      PutVarint(removed_, previous->pid - last_removed);
+      last_removed = previous->pid;
+      ++removed_count;
+    }
+    uint8_t mask{kAll};
+    if (previous != previous_.end() && previous->pid == row.pid) {
+      mask = (row.status != previous->status ? kStatus : 0) |
+             (row.cpu != previous->cpu ? kCpu : 0) |
+             (row.ram != previous->ram ? kRam : 0) |
+             (row.arrival != previous->arrival ? kArrival : 0) |
+             (row.burst != previous->burst ? kBurst : 0) |
+             (row.user != previous->user ? kUser : 0) |
+             (row.command != previous->command ? kCommand : 0);
+      if (reset_) {
+        // Old ids mean nothing to the decoder any more
+        mask |= kUser | kCommand;
+      }
+      ++previous;
+      if (mask == 0) {
+        continue;
+      }
+    }
+    PutVarint(upserted_, row.pid - last_upserted);
+    last_upserted = row.pid;
+    ++upserted_count;
+    upserted_ += static_cast<char>(mask);
+    if (mask & kStatus) {
+      upserted_ += row.status;
+    }
+    if (mask & kCpu) {
+      PutVarint(upserted_, row.cpu);
+    }
+    if (mask & kRam) {
+      PutVarint(upserted_, row.ram);
+    }
+    if (mask & kArrival) {
+      PutVarint(upserted_, row.arrival);
+    }
+    if (mask & kBurst) {
+      PutVarint(upserted_, row.burst);
+    }
+    if (mask & kUser) {
+      PutVarint(upserted_, row.user);
+    }
+    if (mask & kCommand) {
+      PutVarint(upserted_, row.command);
+    }
+  }
+  for (; previous != previous_.end(); ++previous) {
+    PutVarint(removed_, previous->pid - last_removed);
+    last_removed = previous->pid;
+    ++removed_count;
+  }
+  previous_.swap(current_);
+
+  frame.assign(4, '\0');
+  frame += static_cast<char>(!keyframe_sent_ ? kKeyframe
+                             : reset_       ? kReset
+                                            : kDelta);
+  if (!keyframe_sent_) {
+    PutString(frame, system.operating_system);
+    PutString(frame, system.kernel);
+    keyframe_sent_ = true;
+  }
+  PutVarint(frame, std::lround(system.cpu * 1e4));
+  PutVarint(frame, std::lround(system.memory * 1e4));
+  PutVarint(frame, system.total_processes);
+  PutVarint(frame, system.running_processes);
+  PutVarint(frame, system.uptime);
+  PutVarint(frame, new_strings_);
+  frame += definitions_;
+  PutVarint(frame, removed_count);
+  frame += removed_;
+  PutVarint(frame, upserted_count);
+  frame += upserted_;
+
+  const uint32_t length = frame.size() - 4;
+  for (int i = 0; i < 4; ++i) {
+    frame[i] = static_cast<char>(length >> (8 * i));
+  }
+}
+
+// Returns the id of s, defining it in out on first use
+uint32_t Protocol::Encoder::StringId(string_view s, string &out) {
+  auto found = strings_.find(s);
+  if (found != strings_.end()) {
+    return found->second;
+  }
+  uint32_t id = strings_.size();
+  strings_.emplace(pool_.Intern(s), id);
+  PutString(out, s);
+  ++new_strings_;
+  return id;
+}
+
+// Consumes complete frames from the front of buffer
+bool Protocol::Decoder::Consume(string &buffer) {
+  size_t offset{0};
+  while (buffer.size() - offset >= 4) {
+    uint32_t length{0};
+    for (int i = 0; i < 4; ++i) {
+      length |= static_cast<uint32_t>(
+                    static_cast<unsigned char>(buffer[offset + i]))
+                << (8 * i);
+    }
+    if (buffer.size() - offset - 4 < length) {
+      break;
+    }
+    const char *data = buffer.data() + offset + 4;
+    if (!Decode(data, data + length)) {
+      return false;
+    }
+    last_frame_bytes_ = length + 4;
+    offset += length + 4;
+  }
+  buffer.erase(0, offset);
+  return true;
+}
+
+// Return the system values of the last frame
+SystemSnapshot const &Protocol::Decoder::System() const { return system_; }
+
+// Return the processes of the last frame, sorted by CPU utilization
+vector<Process> &Protocol::Decoder::Processes() { return sorted_; }
+
+// Return the size of the last frame on the wire
+size_t Protocol::Decoder::LastFrameBytes() const { return last_frame_bytes_; }
+
+// Starts a new string table; the views of the current rows stay valid
+// until the next reset, by which time every row has been redefined
+void Protocol::Decoder::ResetStrings() {
+  retired_ = std::move(strings_);
+  strings_ = StringPool();
+  table_.clear();
+}
+
+// Applies one frame payload
+bool Protocol::Decoder::Decode(const char *cursor, const char *end) {
+  if (cursor == end) {
+    return false;
+  }
+  const uint8_t type = *cursor++;
+  if (type == kKeyframe) {
+    string_view os, kernel;
+    if (!GetString(cursor, end, os) || !GetString(cursor, end, kernel)) {
+      return false;
+    }
+    ResetStrings();
+    system_.operating_system = strings_.Intern(os);
+    system_.kernel = strings_.Intern(kernel);
+    processes_.clear();
+  } else if (type == kReset) {
+    ResetStrings();
+    system_.operating_system = strings_.Intern(system_.operating_system);
+    system_.kernel = strings_.Intern(system_.kernel);
+  } else if (type != kDelta) {
+    return false;
+  }
+
+  unsigned long cpu, memory, total, running, uptime, definitions;
+  if (!GetVarint(cursor, end, cpu) || !GetVarint(cursor, end, memory) ||
+      !GetVarint(cursor, end, total) || !GetVarint(cursor, end, running) ||
+      !GetVarint(cursor, end, uptime) ||
+      !GetVarint(cursor, end, definitions)) {
+    return false;
+  }
+  system_.cpu = cpu / 1e4f;
+  system_.memory = memory / 1e4f;
+  system_.total_processes = total;
+  system_.running_processes = running;
+  system_.uptime = uptime;
+  for (unsigned long i = 0; i < definitions; ++i) {
+    string_view s;
+    if (!GetString(cursor, end, s)) {
+      return false;
+    }
+    table_.push_back(strings_.Intern(s));
+  }
+
+  // Removed pids, then upserted rows, both ascending
+  unsigned long count, gap;
+  if (!GetVarint(cursor, end, count)) {
+    return false;
+  }
+  removed_.clear();
+  int pid{0};
+  for (unsigned long i = 0; i < count; ++i) {
+    if (!GetVarint(cursor, end, gap)) {
+      return false;
+    }
+    pid += gap;
+    removed_.push_back(pid);
+  }
+
+  if (!GetVarint(cursor, end, count)) {
+    return false;
+  }
+  next_.clear();
+  auto current = processes_.begin();
+  auto removed = removed_.begin();
+  // Copies unchanged rows before pid, dropping removed ones
+  auto carry = [&](int pid) {
+    for (; current != processes_.end() && current->Pid() < pid; ++current) {
+      for (; removed != removed_.end() && *removed < current->Pid();
+           ++removed) {
+      }
+      if (removed == removed_.end() || *removed != current->Pid()) {
+        next_.push_back(*current);
+      }
+    }
+  };
+  pid = 0;
+  for (unsigned long i = 0; i < count; ++i) {
+    unsigned long mask, value;
+    if (!GetVarint(cursor, end, gap) || cursor == end) {
+      return false;
+    }
+    pid += gap;
+    carry(pid);
+    mask = static_cast<uint8_t>(*cursor++);
+    Process process(pid);
+    if (current != processes_.end() && current->Pid() == pid) {
+      process = *current++;
+    } else if (mask != kAll) {
+      return false;
+    }
+    char status = process.Status();
+    float cpu_utilization = process.getCpuUtilization();
+    long ram = process.Ram(), arrival = process.ArrivalTime(),
+         burst = process.BurstTime();
+    if (mask & kStatus) {
+      if (cursor == end) {
+        return false;
+      }
+      status = *cursor++;
+    }
+    if (mask & kCpu) {
+      if (!GetVarint(cursor, end, value)) {
+        return false;
+      }
+      cpu_utilization = value / 1e4f;
+    }
+    for (auto field : {std::make_pair(kRam, &ram),
+                       std::make_pair(kArrival, &arrival),
+                       std::make_pair(kBurst, &burst)}) {
+      if (mask & field.first) {
+        if (!GetVarint(cursor, end, value)) {
+          return false;
+        }
+        *field.second = value;
+      }
+    }
+    for (auto field : {kUser, kCommand}) {
+      if (mask & field) {
+        if (!GetVarint(cursor, end, value) || value >= table_.size()) {
+          return false;
+        }
+        if (field == kUser) {
+          process.SetUser(table_[value]);
+        } else {
+          process.SetCommand(table_[value]);
+        }
+      }
+    }
+    process.Restore(status, cpu_utilization, ram, arrival, burst, 0);
+    next_.push_back(process);
+  }
+  carry(std::numeric_limits<int>::max());
+  if (cursor != end) {
+    return false;
+  }
+  processes_.swap(next_);
+
+  // The age of every process follows from the agent's uptime
+  sorted_.clear();
+  for (Process &process : processes_) {
+    process.Restore(process.Status(), process.getCpuUtilization(),
+                    process.Ram(), process.ArrivalTime(), process.BurstTime(),
+                    system_.uptime - process.ArrivalTime());
+    sorted_.push_back(process);
+  }
+  std::sort(sorted_.begin(), sorted_.end(),
+            [](Process const &a, Process const &b) { return b < a; });
+  return true;
+}
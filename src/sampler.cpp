@@ -0,0 +1,78 @@
+#include <algorithm>
+
+#include "sampler.h"
+
+using std::chrono::milliseconds;
+using std::vector;
+
+// A jump in utilization (0..1) this large counts as a spike
+constexpr float kCpuSpike{0.2};
+// Utilization (0..1) above which the system counts as busy
+constexpr float kCpuBusy{0.9};
+// CPU pressure (avg10, in %) above which tasks count as stalled
+constexpr float kPressureSpike{10.0};
+
+// Returns whether the system counters should be sampled now
+bool Sampler::SystemDue(Clock::time_point now) {
+  if (now < next_system_) {
+    return false;
+  }
+  next_system_ = now + kSystemInterval;
+  return true;
+}
+
+// Returns whether the per-process scan should run now
+bool Sampler::ProcessesDue(Clock::time_point now) {
+  if (now < next_processes_) {
+    return false;
+  }
+  next_processes_ = now + process_interval_;
+  return true;
+}
+
+// Speeds the process scan up when the CPU or CPU pressure spikes
+void Sampler::ObserveSystem(float cpu_utilization, float cpu_pressure) {
+  bool spike = cpu_utilization > kCpuBusy || cpu_pressure > kPressureSpike ||
+               (prev_cpu_ >= 0 && cpu_utilization - prev_cpu_ > kCpuSpike);
+  prev_cpu_ = cpu_utilization;
+  if (spike && process_interval_ > kMinProcessInterval) {
+    SpeedUp();
+  }
+}
+
+// Backs the process scan off while the process set and top-n are stable
+void Sampler::ObserveProcesses(vector<Process> const &processes, int n) {
+  unsigned long hash{0};
+  for (Process const &process : processes) {
+    // Order independent so that re-sorting alone is not a change
+    hash += static_cast<unsigned long>(process.Pid()) * 2654435761UL;
+  }
+  size_t top = std::min(processes.size(), static_cast<size_t>(n));
+  bool stable = processes.size() == prev_count_ && hash == prev_hash_ &&
+                prev_top_.size() == top;
+  for (size_t i = 0; stable && i < top; ++i) {
+    stable = processes[i].Pid() == prev_top_[i];
+  }
+
+  prev_count_ = processes.size();
+  prev_hash_ = hash;
+  prev_top_.resize(top);
+  for (size_t i = 0; i < top; ++i) {
+    prev_top_[i] = processes[i].Pid();
+  }
+
+  if (stable) {
+    process_interval_ = std::min(process_interval_ * 2, kMaxProcessInterval);
+  } else {
+    process_interval_ = kMinProcessInterval;
+  }
+}
+
+// Returns the current interval between process scans
+milliseconds Sampler::ProcessInterval() const { return process_interval_; }
+
+// Falls back to the fastest rate and rescans at once
+void Sampler::SpeedUp() {
+  process_interval_ = kMinProcessInterval;
+  next_processes_ = Clock::time_point{};
+}
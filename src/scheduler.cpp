@@ -0,0 +1,867 @@
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <set>
+
+#include "scheduler.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+using Scheduler::Job;
+using Scheduler::JobSource;
+using Scheduler::Options;
+using Scheduler::Policy;
+using Scheduler::Result;
+using Scheduler::Task;
+
+// Policies are final so that the simulation loop instantiated for one
+// of them calls it directly, see Simulate(PolicyKind, ...)
+
+// One FIFO run queue
+class Fifo : public Policy {
+public:
+  void Enqueue(Task *task, long) override { queue.push_back(task); }
+  Task *PickNext(long) override {
+    Task *task = queue.front();
+    queue.pop_front();
+    return task;
+  }
+  long Slice(Task const &) const override { return LONG_MAX; }
+  Task *Steal() override {
+    Task *task = queue.back();
+    queue.pop_back();
+    return task;
+  }
+  size_t Size() const override { return queue.size(); }
+
+protected:
+  std::deque<Task *> queue;
+};
+
+// First come, first served, runs every job to completion
+class Fcfs final : public Fifo {
+public:
+  const char *Name() const override { return "FCFS"; }
+};
+
+// Round robin with a fixed quantum
+class RoundRobin final : public Fifo {
+public:
+  explicit RoundRobin(long quantum) : quantum(quantum) {}
+  const char *Name() const override { return "RR"; }
+  long Slice(Task const &) const override { return quantum; }
+
+private:
+  long quantum;
+};
+
+// Shortest remaining time first, arrivals preempt longer jobs
+class Srtf final : public Policy {
+public:
+  const char *Name() const override { return "SRTF"; }
+  bool Preemptive() const override { return true; }
+  bool ShouldPreempt(Task const &running,
+                     Task const &arrived) const override {
+    return arrived.remaining < running.remaining;
+  }
+  void Enqueue(Task *task, long) override {
+    heap.push_back(task);
+    std::push_heap(heap.begin(), heap.end(), Longer());
+  }
+  Task *PickNext(long) override {
+    std::pop_heap(heap.begin(), heap.end(), Longer());
+    Task *task = heap.back();
+    heap.pop_back();
+    return task;
+  }
+  long Slice(Task const &) const override { return LONG_MAX; }
+  // The last element is a leaf, removing it keeps the heap valid
+  Task *Steal() override {
+    Task *task = heap.back();
+    heap.pop_back();
+    return task;
+  }
+  size_t Size() const override { return heap.size(); }
+
+private:
+  struct Longer {
+    bool operator()(Task const *a, Task const *b) const {
+      if (a->remaining != b->remaining) {
+        return a->remaining > b->remaining;
+      }
+      return a->job.arrival > b->job.arrival;
+    }
+  };
+  vector<Task *> heap;
+};
+
+// Multi-level feedback queue: a job that uses its whole slice drops a
+// level, level i gets quantum << i, everything is boosted back to the
+// top level every boost ticks
+class Mlfq final : public Policy {
+public:
+  Mlfq(int levels, long quantum, long boost)
+      : levels(std::max(1, levels)), quantum(quantum), boost(boost) {}
+  const char *Name() const override { return "MLFQ"; }
+  bool Preemptive() const override { return true; }
+  bool ShouldPreempt(Task const &running,
+                     Task const &arrived) const override {
+    return arrived.level < running.level;
+  }
+  void Enqueue(Task *task, long) override {
+    if (task->level >= static_cast<int>(levels.size())) {
+      task->level = levels.size() - 1;
+    }
+    levels[task->level].push_back(task);
+    ++size;
+  }
+  Task *PickNext(long now) override {
+    if (boost > 0 && now >= next_boost) {
+      for (size_t level = 1; level < levels.size(); ++level) {
+        for (Task *task : levels[level]) {
+          task->level = 0;
+          levels[0].push_back(task);
+        }
+        levels[level].clear();
+      }
+      next_boost = now + boost;
+    }
+    for (auto &queue : levels) {
+      if (!queue.empty()) {
+        Task *task = queue.front();
+        queue.pop_front();
+        --size;
+        return task;
+      }
+    }
+    return nullptr;
+  }
+  long Slice(Task const &task) const override {
+    return quantum << task.level;
+  }
+  void Ran(Task &task, long, bool expired) override {
+    if (expired && task.level + 1 < static_cast<int>(levels.size())) {
+      ++task.level;
+    }
+  }
+  Task *Steal() override {
+    for (auto queue = levels.rbegin(); queue != levels.rend(); ++queue) {
+      if (!queue->empty()) {
+        Task *task = queue->back();
+        queue->pop_back();
+        --size;
+        return task;
+      }
+    }
+    return nullptr;
+  }
+  size_t Size() const override { return size; }
+
+private:
+  vector<std::deque<Task *>> levels;
+  long quantum;
+  long boost;
+  long next_boost{0};
+  size_t size{0};
+};
+
+// Priority buckets kept in an ordered tree, round robin inside the
+// highest-priority bucket (the scheme sketched in hybridalgo.h)
+class Hybrid final : public Policy {
+public:
+  Hybrid(int buckets, long quantum)
+      : buckets(std::max(1, buckets)), quantum(quantum) {}
+  const char *Name() const override { return "Hybrid"; }
+  bool Preemptive() const override { return true; }
+  bool ShouldPreempt(Task const &running,
+                     Task const &arrived) const override {
+    return Bucket(arrived) < Bucket(running);
+  }
+  void Enqueue(Task *task, long) override {
+    tree[Bucket(*task)].push_back(task);
+    ++size;
+  }
+  Task *PickNext(long) override {
+    auto highest = tree.begin();
+    Task *task = highest->second.front();
+    highest->second.pop_front();
+    if (highest->second.empty()) {
+      tree.erase(highest);
+    }
+    --size;
+    return task;
+  }
+  long Slice(Task const &) const override { return quantum; }
+  Task *Steal() override {
+    auto lowest = std::prev(tree.end());
+    Task *task = lowest->second.back();
+    lowest->second.pop_back();
+    if (lowest->second.empty()) {
+      tree.erase(lowest);
+    }
+    --size;
+    return task;
+  }
+  size_t Size() const override { return size; }
+
+private:
+  // Nice -20..19 spread over the buckets
+  int Bucket(Task const &task) const {
+    int nice = std::min(19, std::max(-20, task.job.priority));
+    return (nice + 20) * buckets / 40;
+  }
+
+  int buckets;
+  long quantum;
+  std::map<int, std::deque<Task *>> tree;
+  size_t size{0};
+};
+
+// Completely fair scheduling: runs the task that has had the least CPU
+// time for its weight, runnable tasks are kept in a red-black tree
+// ordered by that virtual runtime
+class Fair final : public Policy {
+public:
+  Fair(long latency, long min_granularity)
+      : latency(std::max(1L, latency)),
+        min_granularity(std::max(1L, min_granularity)) {}
+  const char *Name() const override { return "Fair"; }
+  void Enqueue(Task *task, long) override {
+    if (task->first_run < 0) {
+      // A new task starts level with the queue rather than ahead of it
+      task->vruntime = std::max(task->vruntime, min_vruntime);
+    }
+    timeline.insert(task);
+    total_weight += Weight(*task);
+  }
+  Task *PickNext(long) override {
+    Task *task = *timeline.begin();
+    timeline.erase(timeline.begin());
+    total_weight -= Weight(*task);
+    min_vruntime = std::max(min_vruntime, task->vruntime);
+    return task;
+  }
+  // Every runnable task gets its weight's share of the latency target,
+  // the target stretches once shares would drop below the granularity
+  long Slice(Task const &task) const override {
+    const long runnable = timeline.size() + 1;
+    const long period = std::max(latency, runnable * min_granularity);
+    const long weight = Weight(task);
+    return std::max(min_granularity,
+                    period * weight / (total_weight + weight));
+  }
+  void Ran(Task &task, long ran, bool) override {
+    task.vruntime += (ran << Scheduler::kFairShift) * 1024 / Weight(task);
+  }
+  // Takes the task furthest right, its runtime leaves relative to this
+  // queue and Adopt makes it relative to the new one
+  Task *Steal() override {
+    auto last = std::prev(timeline.end());
+    Task *task = *last;
+    timeline.erase(last);
+    total_weight -= Weight(*task);
+    task->vruntime -= min_vruntime;
+    return task;
+  }
+  void Adopt(Task *task, long now) override {
+    task->vruntime += min_vruntime;
+    Enqueue(task, now);
+  }
+  size_t Size() const override { return timeline.size(); }
+
+private:
+  struct Before {
+    bool operator()(Task const *a, Task const *b) const {
+      if (a->vruntime != b->vruntime) {
+        return a->vruntime < b->vruntime;
+      }
+      return std::less<Task const *>()(a, b);
+    }
+  };
+
+  // Load weight of a nice value as in Linux, 1024 at nice 0 and about
+  // 1.25 times more per step down
+  static long Weight(Task const &task) {
+    static const long kWeights[40] = {
+        88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+        9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+        1024,  820,   655,   526,   423,   335,   272,   215,   172,   137,
+        110,   87,    70,    56,    45,    36,    29,    23,    18,    15};
+    return kWeights[std::min(19, std::max(-20, task.job.priority)) + 20];
+  }
+
+  long latency;
+  long min_granularity;
+  std::set<Task *, Before> timeline;
+  long total_weight{0};
+  long min_vruntime{0};
+};
+
+// Keeps the cores of the affinity mask that exist, all of them if none do
+uint64_t Allowed(uint64_t affinity, int cores) {
+  const uint64_t all = cores >= 64 ? ~0ULL : (1ULL << cores) - 1;
+  return (affinity & all) != 0 ? affinity & all : all;
+}
+
+bool Allows(Task const &task, int core) {
+  return (task.job.affinity >> core) & 1;
+}
+
+// Picks the next task of queue that may run on core, the others keep
+// their place
+Task *PickAllowed(Policy &queue, int core, long now, vector<Task *> &aside) {
+  Task *picked = nullptr;
+  while (picked == nullptr && !queue.Empty()) {
+    Task *task = queue.PickNext(now);
+    if (Allows(*task, core)) {
+      picked = task;
+    } else {
+      aside.push_back(task);
+    }
+  }
+  for (Task *task : aside) {
+    queue.Enqueue(task, now);
+  }
+  aside.clear();
+  return picked;
+}
+
+// Moves one task from the victim's queue to core's, false if none may move
+bool Migrate(Policy &victim, Policy &queue, int core, long now) {
+  Task *task = victim.Steal();
+  if (task == nullptr) {
+    return false;
+  }
+  if (!Allows(*task, core)) {
+    victim.Adopt(task, now);
+    return false;
+  }
+  queue.Adopt(task, now);
+  return true;
+}
+} // namespace
+
+Scheduler::VectorSource::VectorSource(vector<Job> jobs)
+    : jobs(std::move(jobs)) {}
+
+bool Scheduler::VectorSource::Next(Job &job) {
+  if (next == jobs.size()) {
+    return false;
+  }
+  job = jobs[next++];
+  return true;
+}
+
+// Returns a new run queue of the given kind
+unique_ptr<Policy> Scheduler::MakePolicy(PolicyKind kind,
+                                         Options const &options) {
+  switch (kind) {
+  case kFcfs_:
+    return unique_ptr<Policy>(new Fcfs());
+  case kRoundRobin_:
+    return unique_ptr<Policy>(new RoundRobin(options.quantum));
+  case kSrtf_:
+    return unique_ptr<Policy>(new Srtf());
+  case kMlfq_:
+    return unique_ptr<Policy>(
+        new Mlfq(options.mlfq_levels, options.quantum, options.mlfq_boost));
+  case kFair_:
+    return unique_ptr<Policy>(
+        new Fair(options.fair_latency, options.fair_min_granularity));
+  case kHybrid_:
+  default:
+    return unique_ptr<Policy>(
+        new Hybrid(options.hybrid_buckets, options.quantum));
+  }
+}
+
+// Returns the label of a task state
+const char *Scheduler::StateName(TaskState state) {
+  switch (state) {
+  case kWaiting_:
+    return "Waiting";
+  case kReady_:
+    return "Ready";
+  case kRunning_:
+    return "Running";
+  case kDone_:
+  default:
+    return "Done";
+  }
+}
+
+// Returns the name of a load-balancing strategy
+const char *Scheduler::BalanceName(Balance balance) {
+  switch (balance) {
+  case kGlobal_:
+    return "global";
+  case kPushPull_:
+    return "push-pull";
+  case kWorkStealing_:
+  default:
+    return "stealing";
+  }
+}
+
+namespace {
+// The single-CPU simulation loop, P is either a final policy or the
+// Policy interface itself
+template <typename P>
+Result Run(P &policy, JobSource &source, Options const &options) {
+  Result result;
+  result.policy = policy.Name();
+
+  // Tasks are recycled so memory follows the runnable set, not the trace
+  std::deque<Task> storage;
+  vector<Task *> free_tasks;
+  Job pending;
+  bool has_pending = source.Next(pending);
+  long now = has_pending ? pending.arrival : 0;
+  const long start = now;
+  Task *running = nullptr;
+  Task *previous = nullptr;
+  long slice{0};
+  long slice_left{0};
+  double slowdowns{0.0};
+  double slowdown_squares{0.0};
+  bool preempt{false};
+
+  while (true) {
+    // Admit every job that has arrived by now
+    while (has_pending && pending.arrival <= now) {
+      Task *task;
+      if (free_tasks.empty()) {
+        storage.emplace_back();
+        task = &storage.back();
+      } else {
+        task = free_tasks.back();
+        free_tasks.pop_back();
+      }
+      *task = Task{pending, pending.burst, -1, 0, -1, 0};
+      policy.Enqueue(task, now);
+      preempt = preempt ||
+                (running != nullptr && policy.ShouldPreempt(*running, *task));
+      has_pending = source.Next(pending);
+    }
+
+    if (running != nullptr && (slice_left == 0 || preempt)) {
+      policy.Ran(*running, slice - slice_left, slice_left == 0);
+      policy.Enqueue(running, now);
+      running = nullptr;
+    }
+    preempt = false;
+
+    if (running == nullptr && !policy.Empty()) {
+      running = policy.PickNext(now);
+      ++result.dispatches;
+      if (running != previous) {
+        ++result.context_switches;
+        now += options.context_switch;
+      }
+      if (running->first_run < 0) {
+        running->first_run = now;
+      }
+      slice = policy.Slice(*running);
+      slice_left = slice;
+      previous = running;
+    }
+    if (running == nullptr) {
+      if (!has_pending) {
+        break;
+      }
+      // Idle until the next arrival
+      now = pending.arrival;
+      continue;
+    }
+
+    // Run until the slice ends, the job completes or a job may preempt it
+    long span = std::min(slice_left, running->remaining);
+    if (policy.Preemptive() && has_pending) {
+      span = std::min(span, std::max(1L, pending.arrival - now));
+    }
+    now += span;
+    running->remaining -= span;
+    slice_left -= span;
+    result.busy += span;
+
+    if (running->remaining == 0) {
+      const long turnaround = now - running->job.arrival;
+      const long waiting = turnaround - running->job.burst;
+      ++result.jobs;
+      result.turnaround += turnaround;
+      result.waiting += waiting;
+      result.response += running->first_run - running->job.arrival;
+      result.waiting_histogram.Add(waiting);
+      const double slowdown =
+          static_cast<double>(turnaround) / running->job.burst;
+      slowdowns += slowdown;
+      slowdown_squares += slowdown * slowdown;
+      policy.Ran(*running, slice - slice_left, false);
+      free_tasks.push_back(running);
+      running = nullptr;
+      previous = nullptr;
+    }
+  }
+
+  result.makespan = now - start;
+  if (result.jobs > 0) {
+    result.turnaround /= result.jobs;
+    result.waiting /= result.jobs;
+    result.response /= result.jobs;
+    result.fairness = slowdowns * slowdowns / result.jobs / slowdown_squares;
+  }
+  return result;
+}
+} // namespace
+
+// Runs every job of source on one simulated CPU under policy
+Scheduler::Result Scheduler::Simulate(Policy &policy, JobSource &source,
+                                      Options const &options) {
+  return Run(policy, source, options);
+}
+
+// Same, with the policy chosen once here rather than on every call
+Scheduler::Result Scheduler::Simulate(PolicyKind kind, JobSource &source,
+                                      Options const &options) {
+  switch (kind) {
+  case kFcfs_: {
+    Fcfs policy;
+    return Run(policy, source, options);
+  }
+  case kRoundRobin_: {
+    RoundRobin policy(options.quantum);
+    return Run(policy, source, options);
+  }
+  case kSrtf_: {
+    Srtf policy;
+    return Run(policy, source, options);
+  }
+  case kMlfq_: {
+    Mlfq policy(options.mlfq_levels, options.quantum, options.mlfq_boost);
+    return Run(policy, source, options);
+  }
+  case kFair_: {
+    Fair policy(options.fair_latency, options.fair_min_granularity);
+    return Run(policy, source, options);
+  }
+  case kHybrid_:
+  default: {
+    Hybrid policy(options.hybrid_buckets, options.quantum);
+    return Run(policy, source, options);
+  }
+  }
+}
+
+// Cores advance together from event to event: an arrival, a slice end,
+// a completion or a balancing tick. Context switch and migration costs
+// are charged to the task, they lengthen its remaining time.
+Scheduler::Result Scheduler::SimulateCores(PolicyKind kind, JobSource &source,
+                                           Options const &options) {
+  struct Core {
+    Policy *queue;
+    Task *running;
+    Task *previous;
+    long slice;
+    long slice_left;
+    bool preempt;
+  };
+  const int n = std::min(64, std::max(1, options.cores));
+  vector<unique_ptr<Policy>> queues;
+  vector<Core> cores(n);
+  for (int c = 0; c < n; ++c) {
+    if (options.balance != kGlobal_ || queues.empty()) {
+      queues.push_back(MakePolicy(kind, options));
+    }
+    cores[c] = Core{queues.back().get(), nullptr, nullptr, 0, 0, false};
+  }
+  const bool preemptive = queues[0]->Preemptive();
+
+  Result result;
+  result.policy = queues[0]->Name();
+  result.balance = BalanceName(options.balance);
+  result.core_busy.assign(n, 0);
+
+  std::deque<Task> storage;
+  vector<Task *> free_tasks;
+  vector<Task *> aside;
+  // Fixed seed, runs are reproducible
+  std::minstd_rand random(1);
+  Job pending;
+  bool has_pending = source.Next(pending);
+  long now = has_pending ? pending.arrival : 0;
+  const long start = now;
+  long next_balance = now + options.balance_interval;
+  double slowdowns{0.0};
+  double slowdown_squares{0.0};
+  auto load = [&cores](int c) {
+    return cores[c].queue->Size() + (cores[c].running != nullptr ? 1 : 0);
+  };
+
+  while (true) {
+    while (has_pending && pending.arrival <= now) {
+      Task *task;
+      if (free_tasks.empty()) {
+        storage.emplace_back();
+        task = &storage.back();
+      } else {
+        task = free_tasks.back();
+        free_tasks.pop_back();
+      }
+      *task = Task{pending, pending.burst, -1, 0, -1, 0};
+      task->job.affinity = Allowed(pending.affinity, n);
+
+      // Per-core queues: the least loaded core or, when stealing, a
+      // fixed home core so that idle cores have to come and take work
+      int target{0};
+      if (options.balance == kPushPull_) {
+        target = -1;
+        for (int c = 0; c < n; ++c) {
+          if (Allows(*task, c) && (target < 0 || load(c) < load(target))) {
+            target = c;
+          }
+        }
+      } else if (options.balance == kWorkStealing_) {
+        target = task->job.pid % n;
+        if (!Allows(*task, target)) {
+          target = __builtin_ctzll(task->job.affinity);
+        }
+      }
+      cores[target].queue->Enqueue(task, now);
+
+      if (preemptive) {
+        const int first = options.balance == kGlobal_ ? 0 : target;
+        const int last = options.balance == kGlobal_ ? n - 1 : target;
+        for (int c = first; c <= last; ++c) {
+          if (!Allows(*task, c)) {
+            continue;
+          }
+          if (cores[c].running == nullptr) {
+            // An idle core takes it anyway
+            break;
+          }
+          if (cores[c].queue->ShouldPreempt(*cores[c].running, *task)) {
+            cores[c].preempt = true;
+            break;
+          }
+        }
+      }
+      has_pending = source.Next(pending);
+    }
+
+    for (Core &core : cores) {
+      if (core.running != nullptr && (core.slice_left == 0 || core.preempt)) {
+        core.queue->Ran(*core.running, core.slice - core.slice_left,
+                        core.slice_left == 0);
+        core.queue->Enqueue(core.running, now);
+        core.running = nullptr;
+      }
+      core.preempt = false;
+    }
+
+    if (options.balance == kPushPull_ && now >= next_balance) {
+      // Push from the busiest to the idlest core until within one task
+      while (true) {
+        int busiest{0};
+        int idlest{0};
+        for (int c = 1; c < n; ++c) {
+          busiest = load(c) > load(busiest) ? c : busiest;
+          idlest = load(c) < load(idlest) ? c : idlest;
+        }
+        if (load(busiest) - load(idlest) <= 1 ||
+            !Migrate(*cores[busiest].queue, *cores[idlest].queue, idlest,
+                     now)) {
+          break;
+        }
+      }
+      next_balance = now + options.balance_interval;
+    }
+    if (options.balance != kGlobal_) {
+      // Idle cores pull from the longest queue or steal from a victim
+      for (int c = 0; c < n; ++c) {
+        if (cores[c].running != nullptr || !cores[c].queue->Empty()) {
+          continue;
+        }
+        int victim{-1};
+        if (options.balance == kPushPull_) {
+          for (int v = 0; v < n; ++v) {
+            if (cores[v].queue->Size() > 0 &&
+                (victim < 0 ||
+                 cores[v].queue->Size() > cores[victim].queue->Size())) {
+              victim = v;
+            }
+          }
+        } else {
+          const int first = random() % n;
+          for (int probe = 0; probe < n && victim < 0; ++probe) {
+            const int v = (first + probe) % n;
+            if (v != c && !cores[v].queue->Empty()) {
+              victim = v;
+            }
+          }
+        }
+        if (victim >= 0) {
+          Migrate(*cores[victim].queue, *cores[c].queue, c, now);
+        }
+      }
+    }
+
+    bool busy{false};
+    bool idle{false};
+    for (int c = 0; c < n; ++c) {
+      Core &core = cores[c];
+      if (core.running == nullptr) {
+        Task *task = PickAllowed(*core.queue, c, now, aside);
+        if (task != nullptr) {
+          ++result.dispatches;
+          if (task->core >= 0 && task->core != c) {
+            ++result.migrations;
+            task->remaining += options.migration_cost;
+          }
+          if (task != core.previous) {
+            ++result.context_switches;
+            task->remaining += options.context_switch;
+          }
+          task->core = c;
+          if (task->first_run < 0) {
+            task->first_run = now;
+          }
+          core.running = task;
+          core.previous = task;
+          core.slice = core.queue->Slice(*task);
+          core.slice_left = core.slice;
+        }
+      }
+      busy = busy || core.running != nullptr;
+      idle = idle || core.running == nullptr;
+    }
+    if (!busy) {
+      // Nothing queued either: every queued task may run on some idle core
+      if (!has_pending) {
+        break;
+      }
+      now = pending.arrival;
+      continue;
+    }
+
+    long span{LONG_MAX};
+    for (Core const &core : cores) {
+      if (core.running != nullptr) {
+        span = std::min(span,
+                        std::min(core.slice_left, core.running->remaining));
+      }
+    }
+    if (has_pending && (preemptive || idle)) {
+      span = std::min(span, std::max(1L, pending.arrival - now));
+    }
+    if (options.balance == kPushPull_) {
+      span = std::min(span, std::max(1L, next_balance - now));
+    }
+    now += span;
+
+    for (int c = 0; c < n; ++c) {
+      Core &core = cores[c];
+      if (core.running == nullptr) {
+        continue;
+      }
+      core.running->remaining -= span;
+      core.slice_left -= span;
+      result.core_busy[c] += span;
+      if (core.running->remaining == 0) {
+        Task *done = core.running;
+        const long turnaround = now - done->job.arrival;
+        const long waiting = turnaround - done->job.burst;
+        ++result.jobs;
+        result.turnaround += turnaround;
+        result.waiting += waiting;
+        result.response += done->first_run - done->job.arrival;
+        result.waiting_histogram.Add(waiting);
+        const double slowdown =
+            static_cast<double>(turnaround) / done->job.burst;
+        slowdowns += slowdown;
+        slowdown_squares += slowdown * slowdown;
+        core.queue->Ran(*done, core.slice - core.slice_left, false);
+        for (Core &other : cores) {
+          other.previous = other.previous == done ? nullptr : other.previous;
+        }
+        free_tasks.push_back(done);
+        core.running = nullptr;
+      }
+    }
+  }
+
+  result.makespan = now - start;
+  for (long busy : result.core_busy) {
+    result.busy += busy;
+  }
+  if (result.jobs > 0) {
+    result.turnaround /= result.jobs;
+    result.waiting /= result.jobs;
+    result.response /= result.jobs;
+    result.fairness = slowdowns * slowdowns / result.jobs / slowdown_squares;
+  }
+  return result;
+}
+
+// Returns the header line of the results table
+string Scheduler::FormatHeader() {
+  char line[160];
+  std::snprintf(line, sizeof(line),
+                "%-8s %10s %12s %12s %12s %12s %6s %10s %6s", "POLICY", "JOBS",
+                "TURNAROUND", "WAIT", "WAIT p99", "RESPONSE", "UTIL%",
+                "SWITCHES", "FAIR");
+  return line;
+}
+
+// Returns one line of the results table
+string Scheduler::FormatResult(Result const &result) {
+  char line[160];
+  std::snprintf(line, sizeof(line),
+                "%-8s %10ld %12.1f %12.1f %12ld %12.1f %6.1f %10ld %6.3f",
+                result.policy.c_str(), result.jobs, result.turnaround,
+                result.waiting, result.waiting_histogram.Percentile(0.99),
+                result.response,
+                result.makespan > 0 ? 100.0 * result.busy / result.makespan
+                                    : 0.0,
+                result.context_switches, result.fairness);
+  return line;
+}
+
+// Returns the header line of the multi-core results table
+string Scheduler::FormatCoresHeader() {
+  char line[160];
+  std::snprintf(line, sizeof(line),
+                "%-8s %-9s %5s %10s %12s %12s %10s %10s %6s %6s %6s %6s",
+                "POLICY", "BALANCE", "CORES", "JOBS", "WAIT", "WAIT p99",
+                "MIGRATIONS", "SWITCHES", "UTIL%", "MIN%", "MAX%", "FAIR");
+  return line;
+}
+
+// Returns one line of the multi-core results table, utilization is the
+// mean over the cores followed by the least and most busy core
+string Scheduler::FormatCoresResult(Result const &result) {
+  long least{0};
+  long most{0};
+  if (!result.core_busy.empty()) {
+    auto range = std::minmax_element(result.core_busy.begin(),
+                                     result.core_busy.end());
+    least = *range.first;
+    most = *range.second;
+  }
+  const double makespan = std::max(1L, result.makespan);
+  const double cores = std::max<size_t>(1, result.core_busy.size());
+  char line[160];
+  std::snprintf(line, sizeof(line),
+                "%-8s %-9s %5zu %10ld %12.1f %12ld %10ld %10ld %6.1f %6.1f "
+                "%6.1f %6.3f",
+                result.policy.c_str(), result.balance.c_str(),
+                result.core_busy.size(), result.jobs, result.waiting,
+                result.waiting_histogram.Percentile(0.99), result.migrations,
+                result.context_switches, 100.0 * result.busy / makespan / cores,
+                100.0 * least / makespan, 100.0 * most / makespan,
+                result.fairness);
+  return line;
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "session.h"
+#include "sweep.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+const char *const kMetricNames[] = {"CPU %", "RSS MB", "IO KB/s", "CSW/s"};
+// Divisors from the recorded units to the reported ones
+constexpr double kUnits[] = {1.0, 1024.0, 1024.0, 1.0};
+// Histograms hold integers, cpu and switches are kept to hundredths
+constexpr double kHistogramScale[] = {100.0, 1.0, 1.0, 100.0};
+
+// Writes a field, tabs and newlines would split the line
+void PutField(FILE *file, std::string_view text) {
+  for (char c : text) {
+    std::fputc(c == '\t' || c == '\n' ? ' ' : c, file);
+  }
+}
+
+// Appends printf-style text to out
+template <typename... Args>
+void Append(string &out, const char *format, Args... args) {
+  char buffer[256];
+  const int length = std::snprintf(buffer, sizeof(buffer), format, args...);
+  out.append(buffer, std::min<int>(length, sizeof(buffer) - 1));
+}
+
+// Formats "<after mean> (<change>)", starred if significant
+void AppendCell(string &out, Session::Delta const &delta,
+                Session::Metric metric) {
+  const double after = delta.after[metric].mean / kUnits[metric];
+  const double change =
+      after - delta.before[metric].mean / kUnits[metric];
+  char cell[32];
+  std::snprintf(cell, sizeof(cell), "%.1f (%+.1f%s)", after, change,
+                delta.Significant(metric) ? "*" : "");
+  Append(out, " %-18s", cell);
+}
+} // namespace
+
+Session::Reader::Reader(string const &path)
+    : file(std::fopen(path.c_str(), "r")), path(path) {
+  if (file == nullptr) {
+    throw std::runtime_error("cannot open " + path);
+  }
+}
+
+Session::Reader::~Reader() {
+  std::fclose(file);
+  std::free(buffer);
+}
+
+// Reads the next sample, false at the end of the session
+bool Session::Reader::Next(Sample &sample) {
+  ssize_t length;
+  while ((length = getline(&buffer, &capacity, file)) >= 0) {
+    ++line;
+    if (buffer[0] == '#' || buffer[0] == '\n') {
+      continue;
+    }
+    if (length > 0 && buffer[length - 1] == '\n') {
+      buffer[--length] = '\0';
+    }
+    char *cursor = buffer;
+    char *end;
+    bool valid{true};
+    sample.time = std::strtol(cursor, &end, 10);
+    valid = valid && end != cursor && *end == '\t';
+    cursor = end;
+    sample.pid = std::strtol(cursor, &end, 10);
+    valid = valid && end != cursor && *end == '\t';
+    for (int metric = 0; valid && metric < kMetricCount_; ++metric) {
+      cursor = end;
+      sample.values[metric] = std::strtod(cursor, &end);
+      valid = end != cursor && *end == '\t';
+    }
+    char *cgroup = end + 1;
+    char *command = valid ? std::strchr(cgroup, '\t') : nullptr;
+    if (command == nullptr) {
+      throw std::runtime_error(path + ":" + std::to_string(line) +
+                               ": expected <ms> <pid> <cpu> <rss> <io> "
+                               "<switches> <cgroup> <command>");
+    }
+    // Assigning reuses the capacity of the previous sample
+    sample.cgroup.assign(cgroup, command);
+    sample.command.assign(command + 1, buffer + length);
+    return true;
+  }
+  return false;
+}
+
+// Every process of every scan becomes one sample
+void Session::Record(System &system, string const &path, int seconds,
+                     int interval_ms) {
+  FILE *file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    throw std::runtime_error("cannot write " + path);
+  }
+  std::fprintf(file, "# ms pid cpu_percent rss_kb io_bytes_per_s "
+                     "switches_per_s cgroup command\n");
+
+  using Clock = std::chrono::steady_clock;
+  const auto start = Clock::now();
+  const auto end = start + std::chrono::seconds(seconds);
+  // The first scan only sets the baseline of every rate
+  system.Processes();
+  for (auto next = start + std::chrono::milliseconds(interval_ms);
+       next <= end; next += std::chrono::milliseconds(interval_ms)) {
+    std::this_thread::sleep_until(next);
+    const long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Clock::now() - start)
+                         .count();
+    for (Process const &process : system.Processes()) {
+      std::fprintf(file, "%ld\t%d\t%.2f\t%ld\t%.0f\t%.1f\t", now,
+                   process.Pid(), process.getCpuUtilization() * 100,
+                   process.Resident(), process.IoRate(),
+                   process.SwitchRate());
+      PutField(file, process.Cgroup());
+      std::fputc('\t', file);
+      PutField(file, process.Command());
+      std::fputc('\n', file);
+    }
+  }
+  if (std::fclose(file) != 0) {
+    throw std::runtime_error("cannot write " + path);
+  }
+}
+
+void Session::Moments::Add(double value) {
+  ++n;
+  const double step = value - mean;
+  mean += step / n;
+  m2 += step * (value - mean);
+  max = n == 1 ? value : std::max(max, value);
+}
+
+// Returns the sample variance, 0 below two values
+double Session::Moments::Variance() const {
+  return n > 1 ? m2 / (n - 1) : 0.0;
+}
+
+bool Session::Delta::Significant(Metric metric) const {
+  Moments const &a = before[metric];
+  Moments const &b = after[metric];
+  if (a.n < 2 || b.n < 2) {
+    return false;
+  }
+  const double va = a.Variance() / a.n;
+  const double vb = b.Variance() / b.n;
+  const double se2 = va + vb;
+  if (se2 == 0.0) {
+    // Constant in both sessions, any change is real
+    return a.mean != b.mean;
+  }
+  const double t = (b.mean - a.mean) / std::sqrt(se2);
+  // Welch-Satterthwaite degrees of freedom
+  const double df = se2 * se2 / (va * va / (a.n - 1) + vb * vb / (b.n - 1));
+  return std::fabs(t) > Sweep::TQuantile(static_cast<int>(df) + 1);
+}
+
+// Builds statistics of the first session, then streams the second
+Session::Report Session::Diff(string const &before, string const &after) {
+  Report report;
+  vector<Delta> &deltas = report.deltas;
+  std::unordered_map<string, size_t> index;
+  string key;
+  Sample sample;
+  for (int side = 0; side < 2; ++side) {
+    Reader reader(side == 0 ? before : after);
+    Histogram *histograms = side == 0 ? report.before : report.after;
+    while (reader.Next(sample)) {
+      key.assign(sample.cgroup).append(1, '\t').append(sample.command);
+      auto found = index.find(key);
+      if (found == index.end()) {
+        found = index.emplace(key, deltas.size()).first;
+        deltas.push_back(Delta{sample.cgroup, sample.command, {}, {}});
+      }
+      Moments *moments = side == 0 ? deltas[found->second].before
+                                   : deltas[found->second].after;
+      for (int metric = 0; metric < kMetricCount_; ++metric) {
+        moments[metric].Add(sample.values[metric]);
+        histograms[metric].Add(
+            std::lround(sample.values[metric] * kHistogramScale[metric]));
+      }
+    }
+  }
+  for (Delta const &delta : deltas) {
+    report.gone += delta.after[kCpu_].n == 0;
+    report.added += delta.before[kCpu_].n == 0;
+  }
+  deltas.erase(std::remove_if(deltas.begin(), deltas.end(),
+                              [](Delta const &delta) {
+                                return delta.before[kCpu_].n == 0 ||
+                                       delta.after[kCpu_].n == 0;
+                              }),
+               deltas.end());
+  auto change = [](Delta const &delta) {
+    return delta.after[kCpu_].mean - delta.before[kCpu_].mean;
+  };
+  std::sort(deltas.begin(), deltas.end(),
+            [&change](Delta const &a, Delta const &b) {
+              return change(a) > change(b);
+            });
+  return report;
+}
+
+// Distributions of both sessions, then every identity with the mean of
+// the second session and its change, * where significant
+string Session::FormatReport(Report const &report) {
+  string out;
+  Append(out, "%-8s %10s %10s %10s %10s %10s %10s\n", "METRIC", "P50 BEFORE",
+         "P50 AFTER", "P95 BEFORE", "P95 AFTER", "MAX BEFORE", "MAX AFTER");
+  for (int metric = 0; metric < kMetricCount_; ++metric) {
+    const double scale = kUnits[metric] * kHistogramScale[metric];
+    Histogram const &a = report.before[metric];
+    Histogram const &b = report.after[metric];
+    Append(out, "%-8s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+           kMetricNames[metric], a.Percentile(0.5) / scale,
+           b.Percentile(0.5) / scale, a.Percentile(0.95) / scale,
+           b.Percentile(0.95) / scale, a.Max() / scale, b.Max() / scale);
+  }
+  Append(out, "\n%ld samples before, %ld after; %zu processes in both, "
+              "%ld new, %ld gone\n\n",
+         report.before[kCpu_].Count(), report.after[kCpu_].Count(),
+         report.deltas.size(), report.added, report.gone);
+
+  Append(out, "%-11s", "SAMPLES");
+  for (int metric = 0; metric < kMetricCount_; ++metric) {
+    Append(out, " %-18s", kMetricNames[metric]);
+  }
+  out += " COMMAND [CGROUP]\n";
+  for (Delta const &delta : report.deltas) {
+    char samples[32];
+    std::snprintf(samples, sizeof(samples), "%ld/%ld",
+                  delta.before[kCpu_].n, delta.after[kCpu_].n);
+    Append(out, "%-11s", samples);
+    for (int metric = 0; metric < kMetricCount_; ++metric) {
+      AppendCell(out, delta, static_cast<Metric>(metric));
+    }
+    out += ' ';
+    out.append(delta.command, 0, 60);
+    if (!delta.cgroup.empty()) {
+      out += " [" + delta.cgroup + "]";
+    }
+    out += '\n';
+  }
+  return out;
+}
@@ -0,0 +1,41 @@
+#include <cstring>
+
+#include "string_pool.h"
+
+using std::string_view;
+
+// Returns the pooled copy of s, copying it in on first sight
+string_view StringPool::Intern(string_view s) {
+  if (s.empty()) {
+    // No chunk to point into yet, every empty string shares one address
+    static const char empty[] = "";
+    return string_view(empty, 0);
+  }
+  auto found = index_.find(s);
+  if (found != index_.end()) {
+    return *found;
+  }
+  char *copy;
+  if (s.size() > kChunkSize / 4) {
+    // Oversized strings get a chunk of their own
+    chunks_.emplace_back(new char[s.size()]);
+    copy = chunks_.back().get();
+  } else {
+    if (used_ + s.size() > kChunkSize) {
+      chunks_.emplace_back(new char[kChunkSize]);
+      current_ = chunks_.back().get();
+      used_ = 0;
+    }
+    copy = current_ + used_;
+    used_ += s.size();
+  }
+  std::memcpy(copy, s.data(), s.size());
+  bytes_ += s.size();
+  return *index_.emplace(copy, s.size()).first;
+}
+
+// Returns the number of bytes interned
+size_t StringPool::Bytes() const { return bytes_; }
+
+// Returns the number of distinct strings interned
+size_t StringPool::Size() const { return index_.size(); }
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#include "sweep.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+// SplitMix64, spreads consecutive seeds into unrelated streams
+uint64_t Mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Returns the mean of values and the half width of its 95% interval
+std::pair<double, double> MeanInterval(vector<double> const &values) {
+  const int n = values.size();
+  double sum{0.0};
+  for (double value : values) {
+    sum += value;
+  }
+  const double mean = n > 0 ? sum / n : 0.0;
+  double squares{0.0};
+  for (double value : values) {
+    squares += (value - mean) * (value - mean);
+  }
+  const double deviation = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+  return {mean,
+          n > 1 ? Sweep::TQuantile(n) * deviation / std::sqrt(n) : 0.0};
+}
+
+struct Sample {
+  double wait;
+  double wait_p99;
+  double turnaround;
+  double switches;
+};
+} // namespace
+
+// Two-sided 95% Student t quantile for n - 1 degrees of freedom
+double Sweep::TQuantile(int n) {
+  static const double kTable[] = {0,     12.71, 4.303, 3.182, 2.776, 2.571,
+                                  2.447, 2.365, 2.306, 2.262, 2.228, 2.201,
+                                  2.179, 2.160, 2.145, 2.131, 2.120, 2.110,
+                                  2.101, 2.093, 2.086, 2.080, 2.074, 2.069,
+                                  2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+                                  2.042};
+  const int df = n - 1;
+  return df < 1 ? 0.0 : df <= 30 ? kTable[df] : 1.96;
+}
+
+Sweep::RandomSource::RandomSource(uint64_t seed, long jobs)
+    : random(Mix(seed)), remaining(jobs) {}
+
+bool Sweep::RandomSource::Next(Scheduler::Job &job) {
+  if (remaining-- <= 0) {
+    return false;
+  }
+  std::exponential_distribution<double> interactive(1.0 / 3);
+  std::exponential_distribution<double> batch(1.0 / 40);
+  // Rounded, 1 + lround(x) of an exponential with mean m averages about
+  // 1 + m, so bursts average 1 + 0.8 * 3 + 0.2 * 40 = 11.4 ticks and
+  // arrivals every 12.66 ticks give 90% load
+  std::exponential_distribution<double> gap(1.0 / 12.66);
+  std::uniform_int_distribution<int> nice(-20, 19);
+  now += std::lround(gap(random));
+  const bool cpu_bound = random() % 5 == 0;
+  job = Scheduler::Job{++pid, now,
+                       1 + std::lround(cpu_bound ? batch(random)
+                                                 : interactive(random)),
+                       nice(random)};
+  return true;
+}
+
+// Round robin quanta, MLFQ levels and boost intervals, hybrid buckets,
+// fair scheduler latency targets and granularities
+vector<Sweep::Setting> Sweep::Grid() {
+  const long quanta[] = {1, 2, 4, 8, 16};
+  vector<Setting> settings;
+  for (long quantum : quanta) {
+    Setting setting{Scheduler::kRoundRobin_, {}};
+    setting.options.quantum = quantum;
+    settings.push_back(setting);
+  }
+  for (long quantum : quanta) {
+    for (int levels : {2, 3, 4, 5}) {
+      for (long boost : {50, 100, 200, 400}) {
+        Setting setting{Scheduler::kMlfq_, {}};
+        setting.options.quantum = quantum;
+        setting.options.mlfq_levels = levels;
+        setting.options.mlfq_boost = boost;
+        settings.push_back(setting);
+      }
+    }
+  }
+  for (long quantum : quanta) {
+    for (int buckets : {2, 4, 8, 40}) {
+      Setting setting{Scheduler::kHybrid_, {}};
+      setting.options.quantum = quantum;
+      setting.options.hybrid_buckets = buckets;
+      settings.push_back(setting);
+    }
+  }
+  for (long latency : {3, 6, 12, 24}) {
+    for (long granularity : {1, 2}) {
+      Setting setting{Scheduler::kFair_, {}};
+      setting.options.fair_latency = latency;
+      setting.options.fair_min_granularity = granularity;
+      settings.push_back(setting);
+    }
+  }
+  return settings;
+}
+
+// Workers take (setting, workload) pairs from a shared counter and write
+// each result to its own slot, workload w always uses seed + w
+vector<Sweep::Summary> Sweep::Run(vector<Setting> const &settings,
+                                  int workloads, long jobs, uint64_t seed,
+                                  int threads) {
+  const size_t total = settings.size() * workloads;
+  vector<Sample> samples(total);
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    for (size_t i = next++; i < total; i = next++) {
+      Setting const &setting = settings[i / workloads];
+      RandomSource source(seed + i % workloads, jobs);
+      Scheduler::Result result =
+          Scheduler::Simulate(setting.kind, source, setting.options);
+      samples[i] = Sample{result.waiting,
+                          static_cast<double>(
+                              result.waiting_histogram.Percentile(0.99)),
+                          result.turnaround,
+                          static_cast<double>(result.context_switches)};
+    }
+  };
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  vector<std::thread> workers;
+  for (int t = 1; t < threads; ++t) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  vector<Summary> summaries;
+  vector<double> wait(workloads);
+  vector<double> wait_p99(workloads);
+  vector<double> turnaround(workloads);
+  for (size_t s = 0; s < settings.size(); ++s) {
+    double switches{0.0};
+    for (int w = 0; w < workloads; ++w) {
+      Sample const &sample = samples[s * workloads + w];
+      wait[w] = sample.wait;
+      wait_p99[w] = sample.wait_p99;
+      turnaround[w] = sample.turnaround;
+      switches += sample.switches / workloads;
+    }
+    auto wait_interval = MeanInterval(wait);
+    auto p99_interval = MeanInterval(wait_p99);
+    auto turnaround_interval = MeanInterval(turnaround);
+    summaries.push_back(Summary{settings[s], wait_interval.first,
+                                wait_interval.second, p99_interval.first,
+                                p99_interval.second, turnaround_interval.first,
+                                turnaround_interval.second, switches});
+  }
+  return summaries;
+}
+
+// Returns the header line of the sweep table
+string Sweep::FormatHeader() {
+  char line[160];
+  std::snprintf(line, sizeof(line),
+                "%-7s %4s %6s %6s %7s %4s %4s %20s %20s %20s %10s", "POLICY",
+                "Q", "LEVELS", "BOOST", "BUCKETS", "LAT", "GRAN",
+                "WAIT (95% CI)", "WAIT p99 (95% CI)", "TURNAROUND (95% CI)",
+                "SWITCHES");
+  return line;
+}
+
+// Returns one line of the sweep table, - marks unused parameters
+string Sweep::FormatSummary(Summary const &summary) {
+  Scheduler::Options const &options = summary.setting.options;
+  const bool mlfq = summary.setting.kind == Scheduler::kMlfq_;
+  const bool hybrid = summary.setting.kind == Scheduler::kHybrid_;
+  const bool fair = summary.setting.kind == Scheduler::kFair_;
+  char quantum[16] = "-";
+  char latency[16] = "-";
+  char granularity[16] = "-";
+  char levels[16] = "-";
+  char boost[16] = "-";
+  char buckets[16] = "-";
+  if (mlfq) {
+    std::snprintf(levels, sizeof(levels), "%d", options.mlfq_levels);
+    std::snprintf(boost, sizeof(boost), "%ld", options.mlfq_boost);
+  }
+  if (fair) {
+    std::snprintf(latency, sizeof(latency), "%ld", options.fair_latency);
+    std::snprintf(granularity, sizeof(granularity), "%ld",
+                  options.fair_min_granularity);
+  } else {
+    std::snprintf(quantum, sizeof(quantum), "%ld", options.quantum);
+  }
+  if (hybrid) {
+    std::snprintf(buckets, sizeof(buckets), "%d", options.hybrid_buckets);
+  }
+  auto policy =
+      Scheduler::MakePolicy(summary.setting.kind, summary.setting.options);
+  char line[200];
+  std::snprintf(line, sizeof(line),
+                "%-7s %4s %6s %6s %7s %4s %4s %11.1f +-%6.1f %11.1f +-%6.1f "
+                "%11.1f +-%6.1f %10.0f",
+                policy->Name(), quantum, levels, boost, buckets, latency,
+                granularity,
+                summary.wait, summary.wait_ci, summary.wait_p99,
+                summary.wait_p99_ci, summary.turnaround, summary.turnaround_ci,
+                summary.switches);
+  return line;
+}
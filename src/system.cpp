@@ -1,46 +1,376 @@
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
-#include <set>
+#include <cstdio>
 #include <string>
 #include <unistd.h>
+#include <utility>
 #include <vector>
 
+#include "instrumentation.h"
 #include "linux_parser.h"
 #include "process.h"
 #include "processor.h"
 #include "system.h"
 
-using std::set;
 using std::size_t;
 using std::string;
+using std::string_view;
 using std::vector;
 
+// Interned bytes after which strings of exited processes are dropped
+constexpr size_t kMaxStringBytes{8 * 1024 * 1024};
+// Largest processes whose smaps_rollup is read on every refresh
+constexpr int kMemoryDetail{10};
+
 // Return the system's CPU
 Processor &System::Cpu() { return cpu_; }
 
 // Return a container composed of the system's processes
 vector<Process> &System::Processes() {
   // Get current pids
-  processes_.clear();
-  vector<int> pids = LinuxParser::Pids();
-  for (unsigned int i = 0; i < pids.size(); i++) {
-    Process p = Process(pids[i]);
-    processes_.push_back(p);
+  {
+    Instrumentation::ScopedTimer timer(Instrumentation::kScan_);
+    LinuxParser::Pids(pids_);
+  }
+  {
+    Instrumentation::ScopedTimer timer(Instrumentation::kParse_);
+    index_.clear();
+    for (size_t i = 0; i < processes_.size(); ++i) {
+      index_.emplace_back(processes_[i].Pid(), i);
+    }
+    std::sort(index_.begin(), index_.end());
+
+    const long uptime = LinuxParser::UpTime();
+    const double now = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    next_.clear();
+    filtered_.clear();
+    carried_.assign(processes_.size(), false);
+    // Cheapest filter stage first, the pid needs no read; when scanning
+    // everything it only decides what is shown
+    candidates_.clear();
+    passed_.clear();
+    for (int pid : pids_) {
+      const bool passed = filter_.Matches(pid);
+      if (passed || scan_all_) {
+        candidates_.push_back(pid);
+        passed_.push_back(passed);
+      }
+    }
+    for (size_t first = 0; first < candidates_.size();
+         first += ProcReader::kBatch) {
+      const int count =
+          std::min<size_t>(ProcReader::kBatch, candidates_.size() - first);
+      reader_.Read(&candidates_[first], count);
+      for (int i = 0; i < count; ++i) {
+        const int pid = candidates_[first + i];
+        LinuxParser::ProcessStat stat;
+        LinuxParser::ProcessStatus status;
+        LinuxParser::ProcessIo io;
+        // Skip processes that exited while being read, each read of the
+        // synchronous reader happens only if the stages before pass
+        const char *contents = reader_.Contents(i, ProcReader::kStat_);
+        if (contents == nullptr ||
+            !LinuxParser::ParseProcessStat(contents, stat)) {
+          continue;
+        }
+        bool passed = passed_[first + i] && filter_.Matches(stat);
+        if (!passed && !scan_all_) {
+          continue;
+        }
+        contents = reader_.Contents(i, ProcReader::kStatus_);
+        if (contents == nullptr) {
+          continue;
+        }
+        LinuxParser::ParseProcessStatus(contents, status);
+        passed = passed && filter_.Matches(status);
+        if (!passed && !scan_all_) {
+          continue;
+        }
+        contents = reader_.Contents(i, ProcReader::kIo_);
+        if (contents != nullptr) {
+          LinuxParser::ParseProcessIo(contents, io);
+        }
+        auto found = std::lower_bound(index_.begin(), index_.end(),
+                                      std::make_pair(pid, 0));
+        if (found != index_.end() && found->first == pid) {
+          next_.push_back(processes_[found->second]);
+          carried_[found->second] = true;
+          if (next_.back().Ppid() != stat.ppid) {
+            tree_.Update(pid, stat.ppid);
+          }
+        } else {
+          next_.emplace_back(pid);
+          tree_.Update(pid, stat.ppid);
+        }
+        Process &process = next_.back();
+        process.Update(stat, status, io, uptime, now);
+
+        // Interned views compare by address, a new comm means new or exec'd;
+        // Update drops the comm of a reused pid or an exec keeping its name
+        string_view comm = strings_.Intern(stat.comm);
+        if (process.Comm().data() != comm.data()) {
+          char command[4096];
+          int length = LinuxParser::ReadCommand(pid, command, sizeof(command));
+          if (length == 0) {
+            // Kernel threads have no command line, show [comm] like ps
+            length =
+                std::snprintf(command, sizeof(command), "[%s]", stat.comm);
+          }
+          process.SetComm(comm);
+          process.SetCommand(strings_.Intern(string_view(command, length)));
+          // Processes rarely move between groups after exec
+          length = LinuxParser::ReadCgroup(pid, command, sizeof(command));
+          process.SetCgroup(strings_.Intern(string_view(command, length)));
+        }
+        process.SetUser(UserName(status.uid));
+        // Records failing only the last stage are kept for their history
+        if (Filtering() && passed && filter_.Matches(process)) {
+          filtered_.push_back(process);
+        }
+      }
+    }
+    for (size_t i = 0; i < processes_.size(); ++i) {
+      if (!carried_[i]) {
+        tree_.Remove(processes_[i].Pid());
+      }
+    }
+    processes_.swap(next_);
+    if (strings_.Bytes() > kMaxStringBytes) {
+      CompactStrings();
+    }
+  }
+  vector<Process> &shown = Filtering() ? filtered_ : processes_;
+  {
+    Instrumentation::ScopedTimer timer(Instrumentation::kDetail_);
+    ReadMemoryDetail(shown);
+    if (sockets_) {
+      network_.SampleSockets(pids_);
+      for (Process &process : shown) {
+        process.SetSockets(network_.Of(process.Pid()));
+      }
+    }
+  }
+  {
+    Instrumentation::ScopedTimer timer(Instrumentation::kSort_);
+    if (order_ == kByGrowth_) {
+      // Leaking processes first
+      std::sort(shown.begin(), shown.end(),
+                [](Process const &a, Process const &b) {
+                  return a.Growth() > b.Growth();
+                });
+    } else if (order_ == kByNetwork_) {
+      // Busiest TCP traffic first, then most sockets
+      std::sort(shown.begin(), shown.end(),
+                [](Process const &a, Process const &b) {
+                  const double ab = a.Sockets().rx + a.Sockets().tx;
+                  const double bb = b.Sockets().rx + b.Sockets().tx;
+                  if (ab != bb) {
+                    return ab > bb;
+                  }
+                  return a.Sockets().Count() > b.Sockets().Count();
+                });
+    } else {
+      // Sort processes by cpu usage
+      std::sort(shown.begin(), shown.end(),
+                [](Process const &a, Process const &b) { return b < a; });
+    }
+  }
+  return shown;
+}
+
+// Reads smaps_rollup for the largest and the growing processes only, it
+// costs a walk over every mapping of the process
+void System::ReadMemoryDetail(vector<Process> &records) {
+  largest_.clear();
+  for (size_t i = 0; i < records.size(); ++i) {
+    largest_.push_back(i);
+  }
+  const size_t n = std::min<size_t>(kMemoryDetail, largest_.size());
+  std::nth_element(largest_.begin(), largest_.begin() + n, largest_.end(),
+                   [&records](int a, int b) {
+                     return records[a].Ram() > records[b].Ram();
+                   });
+  std::sort(largest_.begin(), largest_.begin() + n);
+  for (size_t i = 0; i < records.size(); ++i) {
+    Process &process = records[i];
+    LinuxParser::ProcessMemory memory;
+    if (std::binary_search(largest_.begin(), largest_.begin() + n, i) ||
+        process.Growing()) {
+      LinuxParser::ReadProcessMemory(process.Pid(), memory);
+      process.SetMemory(memory);
+    } else if (process.Memory().rss != 0) {
+      // Stale detail would look current
+      process.SetMemory(memory);
+    }
+  }
+}
+
+// Return the processes of the last call to Processes() as a tree,
+// filter terms on the updated record do not prune it unless every
+// process is scanned
+std::vector<ProcessTree::Row> const &System::Tree() {
+  return tree_.Flatten(scan_all_ && Filtering() ? filtered_ : processes_);
+}
+
+// Scan every process from the next scan on, whatever the filter; the
+// filter then only decides what Processes() returns
+void System::ScanAll(bool enabled) { scan_all_ = enabled; }
+
+// Return every process of the last scan, filtered only if not ScanAll()
+vector<Process> const &System::AllProcesses() const { return processes_; }
+
+// Whether Processes() returns filtered_ rather than processes_
+bool System::Filtering() const {
+  if (!scan_all_) {
+    return filter_.Has(Filter::kProcess_);
+  }
+  for (int stage = 0; stage < Filter::kStageCount_; ++stage) {
+    if (filter_.Has(static_cast<Filter::Stage>(stage))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Collapse or expand the children of a process in Tree()
+void System::ToggleSubtree(int pid) { tree_.Toggle(pid); }
+
+// Restrict the processes returned by Processes() from the next scan on
+void System::SetFilter(Filter filter) { filter_ = std::move(filter); }
+
+// Return the current process filter
+Filter const &System::ProcessFilter() const { return filter_; }
+
+// Order the records of the next calls to Processes()
+void System::SetOrder(Order order) { order_ = order; }
+
+// Read /proc through io_uring from the next scan on, false if unavailable
+bool System::EnableUring() { return reader_.EnableUring(); }
+
+// Return the reader of the per-process files
+ProcReader const &System::Reader() const { return reader_; }
+
+// Attribute TCP and UDP sockets to processes from the next scan on
+void System::EnableSockets(bool enabled) { sockets_ = enabled; }
+
+// Return the interface counters and the socket index
+Network &System::Net() { return network_; }
+
+// Return the cgroups of the processes from the last call to Processes()
+vector<Cgroup> &System::Cgroups() {
+  // Count processes per group, groups are interned so pointers identify them
+  cgroup_index_.clear();
+  for (size_t i = 0; i < cgroups_.size(); ++i) {
+    cgroups_[i].SetProcesses(0);
+    cgroup_index_.emplace_back(cgroups_[i].Path().data(), i);
+  }
+  std::sort(cgroup_index_.begin(), cgroup_index_.end());
+  vector<Process> const &shown = Filtering() ? filtered_ : processes_;
+  for (Process const &process : shown) {
+    if (process.Cgroup().empty()) {
+      continue;
+    }
+    const char *key = process.Cgroup().data();
+    auto found = std::lower_bound(cgroup_index_.begin(), cgroup_index_.end(),
+                                  std::make_pair(key, size_t{0}));
+    if (found != cgroup_index_.end() && found->first == key) {
+      Cgroup &cgroup = cgroups_[found->second];
+      cgroup.SetProcesses(cgroup.Processes() + 1);
+    } else {
+      cgroups_.emplace_back(process.Cgroup());
+      cgroups_.back().SetProcesses(1);
+      cgroup_index_.insert(found, std::make_pair(key, cgroups_.size() - 1));
+    }
+  }
+  // Groups without processes are gone or not of interest
+  cgroups_.erase(std::remove_if(cgroups_.begin(), cgroups_.end(),
+                                [](Cgroup const &cgroup) {
+                                  return cgroup.Processes() == 0;
+                                }),
+                 cgroups_.end());
+
+  const double now = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+  for (Cgroup &cgroup : cgroups_) {
+    cgroup.Update(now);
+  }
+  std::sort(cgroups_.begin(), cgroups_.end(),
+            [](Cgroup const &a, Cgroup const &b) { return b < a; });
+  return cgroups_;
+}
+
+// Return the name of a user, reloading the password file on a miss
+string_view System::UserName(int uid) {
+  auto found = users_.find(uid);
+  if (found != users_.end()) {
+    return found->second;
+  }
+  for (auto const &user : LinuxParser::Users()) {
+    users_.emplace(user.first, strings_.Intern(user.second));
   }
-  // Sort processes by cpu usage
-  std::sort(processes_.begin(), processes_.end());
-  std::reverse(processes_.begin(), processes_.end());
-  return processes_;
+  found = users_.find(uid);
+  if (found == users_.end()) {
+    // Unknown to the password file, show the number instead
+    found = users_.emplace(uid, strings_.Intern(std::to_string(uid))).first;
+  }
+  return found->second;
+}
+
+// Drop strings of processes that are gone by re-interning the live ones
+void System::CompactStrings() {
+  StringPool strings;
+  for (vector<Process> *records : {&processes_, &filtered_}) {
+    for (Process &process : *records) {
+      process.SetComm(strings.Intern(process.Comm()));
+      process.SetCommand(strings.Intern(process.Command()));
+      process.SetUser(strings.Intern(process.User()));
+      process.SetCgroup(strings.Intern(process.Cgroup()));
+    }
+  }
+  for (Cgroup &cgroup : cgroups_) {
+    cgroup.SetPath(strings.Intern(cgroup.Path()));
+  }
+  for (auto &user : users_) {
+    user.second = strings.Intern(user.second);
+  }
+  strings_ = std::move(strings);
+}
+
+// Sample the CPU and read the values shown in the system window
+SystemSnapshot System::Snapshot() {
+  SystemSnapshot snapshot;
+  snapshot.operating_system = OperatingSystem();
+  snapshot.kernel = Kernel();
+  snapshot.cpu = cpu_.Utilization();
+  snapshot.memory = MemoryUtilization();
+  snapshot.total_processes = TotalProcesses();
+  snapshot.running_processes = RunningProcesses();
+  snapshot.uptime = UpTime();
+  return snapshot;
 }
 
 // Return the system's kernel identifier (string)
-std::string System::Kernel() { return LinuxParser::Kernel(); }
+std::string const &System::Kernel() {
+  if (kernel_.empty()) {
+    kernel_ = LinuxParser::Kernel();
+  }
+  return kernel_;
+}
 
 // Return the system's memory utilization
 float System::MemoryUtilization() { return LinuxParser::MemoryUtilization(); }
 
 // Return the operating system name
-std::string System::OperatingSystem() { return LinuxParser::OperatingSystem(); }
+std::string const &System::OperatingSystem() {
+  if (operating_system_.empty()) {
+    operating_system_ = LinuxParser::OperatingSystem();
+  }
+  return operating_system_;
+}
 
 // Return the number of processes actively running on the system
 int System::RunningProcesses() { return LinuxParser::RunningProcesses(); }
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "trace.h"
+
+using std::string;
+
+Trace::Reader::Reader(string const &path)
+    : file(std::fopen(path.c_str(), "r")), path(path) {
+  if (file == nullptr) {
+    throw std::runtime_error("cannot open " + path);
+  }
+}
+
+Trace::Reader::~Reader() { std::fclose(file); }
+
+// Reads the next job, false at the end of the trace
+bool Trace::Reader::Next(Scheduler::Job &job) {
+  char buffer[256];
+  while (std::fgets(buffer, sizeof(buffer), file) != nullptr) {
+    ++line;
+    if (buffer[0] == '#' || buffer[0] == '\n') {
+      continue;
+    }
+    unsigned long long affinity{~0ULL};
+    if (std::sscanf(buffer, "%ld %d %ld %d %llx", &job.arrival, &job.pid,
+                    &job.burst, &job.priority, &affinity) < 4 ||
+        job.burst <= 0) {
+      throw std::runtime_error(path + ":" + std::to_string(line) +
+                               ": expected <arrival> <pid> <burst> <nice>");
+    }
+    if (job.arrival < last_arrival) {
+      throw std::runtime_error(path + ":" + std::to_string(line) +
+                               ": arrival out of order");
+    }
+    job.affinity = affinity;
+    last_arrival = job.arrival;
+    return true;
+  }
+  return false;
+}
+
+// Every process that ran during an interval becomes one job
+void Trace::Record(System &system, string const &path, int seconds,
+                   int interval_ms) {
+  FILE *file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    throw std::runtime_error("cannot write " + path);
+  }
+  std::fprintf(file, "# arrival_ms pid burst_ms nice\n");
+
+  using Clock = std::chrono::steady_clock;
+  const auto start = Clock::now();
+  const auto end = start + std::chrono::seconds(seconds);
+  // The first scan only sets the baseline of every process
+  system.Processes();
+  long previous{0};
+  for (auto next = start + std::chrono::milliseconds(interval_ms);
+       next <= end; next += std::chrono::milliseconds(interval_ms)) {
+    std::this_thread::sleep_until(next);
+    const long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         Clock::now() - start)
+                         .count();
+    for (Process const &process : system.Processes()) {
+      if (process.CpuDelta() > 0) {
+        std::fprintf(file, "%ld %d %ld %d\n", previous, process.Pid(),
+                     process.CpuDelta(), process.Nice());
+      }
+    }
+    previous = now;
+  }
+  if (std::fclose(file) != 0) {
+    throw std::runtime_error("cannot write " + path);
+  }
+}
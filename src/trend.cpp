@@ -0,0 +1,55 @@
+#include "trend.h"
+
+// Records a sample, dropping the oldest once the ring is full
+void Trend::Add(double time, double value) {
+  if (count == 0) {
+    origin = time;
+  }
+  if (count == kCapacity) {
+    first = (first + 1) % kCapacity;
+    --count;
+    // Rebase on the new oldest sample and sum again, subtracting the
+    // dropped one would leave the origin further behind on every call
+    const float shift = times[first];
+    origin += shift;
+    sum_t = sum_v = sum_tt = sum_tv = 0.0;
+    for (int i = 0; i < count; ++i) {
+      const int slot = (first + i) % kCapacity;
+      times[slot] -= shift;
+      const double t = times[slot];
+      const double v = values[slot];
+      sum_t += t;
+      sum_v += v;
+      sum_tt += t * t;
+      sum_tv += t * v;
+    }
+  }
+  const int slot = (first + count) % kCapacity;
+  times[slot] = time - origin;
+  values[slot] = value;
+  // Sum the stored floats, as the rebase above does
+  const double t = times[slot];
+  const double v = values[slot];
+  sum_t += t;
+  sum_v += v;
+  sum_tt += t * t;
+  sum_tv += t * v;
+  ++count;
+}
+
+// Returns the change of the value per unit of time, 0 below two samples
+double Trend::Slope() const {
+  const double spread = count * sum_tt - sum_t * sum_t;
+  if (count < 2 || spread <= 0.0) {
+    return 0.0;
+  }
+  return (count * sum_tv - sum_t * sum_v) / spread;
+}
+
+// Returns the number of samples in the window
+int Trend::Count() const { return count; }
+
+// Returns the time of the latest sample
+double Trend::LastTime() const {
+  return count == 0 ? 0.0 : origin + times[(first + count - 1) % kCapacity];
+}
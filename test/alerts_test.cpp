@@ -0,0 +1,145 @@
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "alerts.h"
+#include "process.h"
+#include "snapshot.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+int failures{0};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+// Returns an alerts instance of one rule
+Alerts Single(const char *rule) {
+  return Alerts(vector<Alerts::Rule>{Alerts::Parse(rule)});
+}
+
+// Observes the system cpu at percent, at now seconds
+bool Cpu(Alerts &alerts, double percent, double now) {
+  SystemSnapshot snapshot;
+  snapshot.cpu = percent / 100;
+  alerts.ObserveSystem(snapshot, 0.0f, now);
+  return !alerts.Firing().empty();
+}
+
+Process Row(int pid, long ram) {
+  Process process(pid);
+  process.SetComm("test");
+  process.Restore('S', 0.0f, ram, 0, 0, 0);
+  return process;
+}
+
+// Returns the lines of the file at path
+vector<string> Lines(string const &path) {
+  std::ifstream stream(path);
+  vector<string> lines;
+  string line;
+  while (std::getline(stream, line)) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+} // namespace
+
+// Drives the rules with synthetic timestamps
+int main() {
+  {
+    Alerts alerts = Single("busy system.cpu last 0 > 80 for 10s");
+    bool fired{false};
+    for (int t = 0; t < 10; ++t) {
+      fired = fired || Cpu(alerts, 90, t);
+    }
+    Check(!fired, "debounce holds the alert for 10 s");
+    Check(Cpu(alerts, 90, 10), "debounce fires after 10 s");
+    Check(!Cpu(alerts, 50, 11), "resolves below the threshold");
+    Check(!Cpu(alerts, 90, 12), "a new breach waits again");
+    Check(!Cpu(alerts, 50, 13) && !Cpu(alerts, 90, 14) &&
+              !Cpu(alerts, 90, 23),
+          "an interrupted breach restarts the debounce");
+    Check(Cpu(alerts, 90, 24), "fires 10 s after the restart");
+  }
+  {
+    Alerts alerts = Single("hot system.cpu last 0 > 90 clear 70");
+    Check(Cpu(alerts, 95, 0), "fires past the threshold");
+    Check(Cpu(alerts, 80, 1), "hysteresis keeps it firing above clear");
+    Check(!Cpu(alerts, 65, 2), "resolves below clear");
+    Check(!Cpu(alerts, 85, 3), "does not fire again below the threshold");
+  }
+  {
+    Alerts alerts = Single("hot system.cpu min 30s > 90");
+    bool fired{false};
+    for (int t = 0; t <= 30; ++t) {
+      fired = fired || Cpu(alerts, t == 0 ? 50 : 95, t);
+    }
+    Check(!fired, "the minimum keeps a dip for the whole window");
+    Check(Cpu(alerts, 95, 31), "fires once the dip left the window");
+  }
+  {
+    Alerts alerts = Single("spike system.cpu max 10s > 90");
+    Check(Cpu(alerts, 95, 0), "the maximum fires on a spike");
+    Check(Cpu(alerts, 10, 10), "the spike stays within the window");
+    Check(!Cpu(alerts, 10, 11), "the spike left the window");
+  }
+  {
+    Alerts alerts = Single("mean system.cpu avg 10s > 50");
+    Check(!Cpu(alerts, 30, 0) && !Cpu(alerts, 60, 1),
+          "the average of 30 and 60 is not above 50");
+    Check(Cpu(alerts, 90, 2), "the average of 30, 60 and 90 is");
+    Check(std::fabs(alerts.Firing()[0].value - 60) < 1e-3,
+          "the average is the value fired with");
+  }
+  {
+    // 2 MB more per second is 120 MB per minute
+    const string log = "/tmp/alerts_test_" + std::to_string(getpid());
+    Alerts alerts = Single("leak process.ram rate 60s > 100");
+    alerts.SetLog(log);
+    bool fired{false};
+    for (int t = 0; t < 30; ++t) {
+      alerts.ObserveProcesses({Row(1, 10), Row(2, 100 + 2 * t)}, t);
+      fired = fired || !alerts.Firing().empty();
+    }
+    Check(!fired, "a rate waits for half its window");
+    alerts.ObserveProcesses({Row(1, 10), Row(2, 160)}, 30);
+    Check(alerts.Firing().size() == 1 &&
+              alerts.Firing()[0].entity == "pid 2 (test)" &&
+              std::fabs(alerts.Firing()[0].value - 120) < 1e-3,
+          "the leaking process fires at 120 MB per minute");
+    alerts.ObserveProcesses({Row(1, 10)}, 31);
+    Check(alerts.Firing().empty(), "an exited process resolves");
+    vector<string> lines = Lines(log);
+    Check(lines.size() == 2 && lines[0].find(" FIRING leak pid 2 ") !=
+                                   string::npos &&
+              lines[1].find(" RESOLVED leak pid 2 ") != string::npos,
+          "one FIRING and one RESOLVED line in the log");
+    std::remove(log.c_str());
+  }
+  {
+    // Hooks still running are waited for on exit
+    Alerts alerts = Single("busy system.cpu last 0 > 80");
+    alerts.SetHook("sleep 0.2");
+    Cpu(alerts, 90, 0);
+  }
+  errno = 0;
+  Check(waitpid(-1, nullptr, WNOHANG) == -1 && errno == ECHILD,
+        "no hook is left behind");
+
+  if (failures == 0) {
+    std::printf("alerts_test: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "exporter.h"
+#include "system.h"
+
+using std::string;
+
+namespace {
+int failures{0};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+// Returns the whole response to request on 127.0.0.1:port
+// Returns a socket connected to 127.0.0.1:port, -1 on failure
+int Connect(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) !=
+      0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+string Get(int port, const char *request) {
+  int fd = Connect(port);
+  string response;
+  if (fd < 0 || send(fd, request, std::strlen(request), MSG_NOSIGNAL) < 0) {
+    close(fd);
+    return response;
+  }
+  char buffer[4096];
+  ssize_t n;
+  // The exporter closes the connection after each response
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+    response.append(buffer, n);
+  }
+  close(fd);
+  return response;
+}
+
+bool EndsWith(string const &text, string const &suffix) {
+  return text.size() >= suffix.size() &&
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+} // namespace
+
+// Scrapes an exporter on an ephemeral loopback port
+int main() {
+  System system;
+  Exporter exporter(0);
+  Check(exporter.Port() > 0, "an ephemeral port is bound");
+
+  string response = Get(exporter.Port(), "GET /metrics HTTP/1.1\r\n\r\n");
+  Check(response.rfind("HTTP/1.1 503 ", 0) == 0,
+        "503 before the first Publish");
+
+  exporter.Publish(system, system.Processes());
+  response = Get(exporter.Port(),
+                 "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+  Check(response.rfind("HTTP/1.1 200 OK\r\n", 0) == 0, "200 status line");
+  Check(response.find("\r\nContent-Type: application/openmetrics-text; "
+                      "version=1.0.0; charset=utf-8\r\n") != string::npos,
+        "OpenMetrics content type");
+  Check(response.find("\nmonitor_cpu_utilization ") != string::npos,
+        "system metrics in the body");
+  Check(response.find("\n# UNIT monitor_process_memory_bytes bytes\n") !=
+                string::npos &&
+            response.find("\nmonitor_process_memory_bytes{") != string::npos,
+        "process memory in bytes");
+  Check(EndsWith(response, "# EOF\n"), "# EOF terminator");
+
+  response = Get(exporter.Port(), "GET / HTTP/1.1\r\n\r\n");
+  Check(response.rfind("HTTP/1.1 404 ", 0) == 0, "404 for other paths");
+
+  // A client trickling its request a byte at a time for twice the
+  // timeout holds the other scrapes up for at most the timeout
+  const auto timeout = std::chrono::milliseconds(Exporter::kRequestTimeoutMs);
+  std::thread trickle([&exporter, timeout]() {
+    int fd = Connect(exporter.Port());
+    const auto until = std::chrono::steady_clock::now() + 2 * timeout;
+    while (fd >= 0 && std::chrono::steady_clock::now() < until &&
+           send(fd, "G", 1, MSG_NOSIGNAL) == 1) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    close(fd);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const auto start = std::chrono::steady_clock::now();
+  response = Get(exporter.Port(), "GET /metrics HTTP/1.1\r\n\r\n");
+  Check(response.rfind("HTTP/1.1 200 OK\r\n", 0) == 0,
+        "scrape served behind a trickling client");
+  Check(std::chrono::steady_clock::now() - start <
+            timeout + std::chrono::milliseconds(500),
+        "trickling client cut off at the timeout");
+  trickle.join();
+
+  if (failures == 0) {
+    std::printf("exporter_test: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "process.h"
+#include "protocol.h"
+#include "string_pool.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+int failures{0};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+Process Row(StringPool &pool, int pid, string const &command, long ram) {
+  Process process(pid);
+  process.SetUser(pool.Intern("user" + std::to_string(pid % 2)));
+  process.SetCommand(pool.Intern(command));
+  process.Restore('S', pid / 100.0f, ram, pid * 10, pid, 0);
+  return process;
+}
+
+// Returns the frame type byte, encoding processes into frame
+int Encode(Protocol::Encoder &encoder, SystemSnapshot const &system,
+           vector<Process> const &processes, string &frame) {
+  encoder.Encode(system, processes, frame);
+  return frame.size() > 4 ? frame[4] : -1;
+}
+
+// Whether the decoded rows are exactly processes, in any order
+bool Same(vector<Process> const &decoded, vector<Process> const &processes) {
+  if (decoded.size() != processes.size()) {
+    return false;
+  }
+  for (Process const &expected : processes) {
+    bool found{false};
+    for (Process const &process : decoded) {
+      if (process.Pid() == expected.Pid()) {
+        found = process.User() == expected.User() &&
+                process.Command() == expected.Command() &&
+                process.Ram() == expected.Ram() &&
+                process.Status() == expected.Status() &&
+                process.ArrivalTime() == expected.ArrivalTime() &&
+                process.BurstTime() == expected.BurstTime();
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+// Round-trips a keyframe, deltas and a string table reset
+int main() {
+  StringPool pool;
+  SystemSnapshot system;
+  system.operating_system = pool.Intern("Test OS");
+  system.kernel = pool.Intern("6.0");
+  system.cpu = 0.25f;
+  system.uptime = 1000;
+  Protocol::Encoder encoder;
+  Protocol::Decoder decoder;
+  string frame, buffer;
+
+  vector<Process> processes{Row(pool, 1, "init", 10),
+                            Row(pool, 42, "shell", 20),
+                            Row(pool, 300, "editor", 30)};
+  Check(Encode(encoder, system, processes, frame) == 0, "keyframe first");
+  // Split across reads: nothing is applied until the frame is complete
+  buffer = frame.substr(0, 7);
+  Check(decoder.Consume(buffer) && decoder.Processes().empty(),
+        "partial frame waits");
+  buffer += frame.substr(7);
+  Check(decoder.Consume(buffer) && buffer.empty(), "keyframe decodes");
+  Check(decoder.System().operating_system == "Test OS" &&
+            decoder.System().kernel == "6.0" && decoder.System().cpu == 0.25f,
+        "keyframe system values");
+  Check(Same(decoder.Processes(), processes), "keyframe rows");
+
+  // Changed ram, pid 300 exited, pid 301 appeared
+  processes = {Row(pool, 1, "init", 10), Row(pool, 42, "shell", 25),
+               Row(pool, 301, "compiler", 40)};
+  const size_t keyframe_bytes = frame.size();
+  Check(Encode(encoder, system, processes, frame) == 1, "delta after");
+  buffer = frame;
+  Check(decoder.Consume(buffer), "delta decodes");
+  Check(Same(decoder.Processes(), processes), "delta rows and removal");
+
+  Check(Encode(encoder, system, processes, frame) == 1 &&
+            frame.size() < keyframe_bytes,
+        "unchanged delta is small");
+  buffer = frame;
+  Check(decoder.Consume(buffer) && Same(decoder.Processes(), processes),
+        "unchanged delta decodes");
+
+  // Push the string table past its bound, the frame after resets it
+  const string large(Protocol::kMaxStringBytes / 4, 'x');
+  for (int i = 0; i < 5; ++i) {
+    processes.push_back(Row(pool, 500 + i, large + std::to_string(i), 1));
+  }
+  Check(Encode(encoder, system, processes, frame) == 1, "large delta");
+  buffer = frame;
+  Check(decoder.Consume(buffer) && Same(decoder.Processes(), processes),
+        "large delta decodes");
+  processes.erase(processes.begin() + 3, processes.end());
+  processes[0] = Row(pool, 1, "init", 11);
+  Check(Encode(encoder, system, processes, frame) == 2, "reset frame");
+  buffer = frame;
+  Check(decoder.Consume(buffer) && Same(decoder.Processes(), processes),
+        "reset frame decodes");
+  Check(decoder.System().operating_system == "Test OS",
+        "system strings survive the reset");
+  Check(Encode(encoder, system, processes, frame) == 1, "delta after reset");
+  buffer = frame;
+  Check(decoder.Consume(buffer) && Same(decoder.Processes(), processes),
+        "delta after reset decodes");
+
+  // A new connection starts with a keyframe of its own
+  Protocol::Encoder resync;
+  Protocol::Decoder fresh;
+  Check(Encode(resync, system, processes, frame) == 0, "resync keyframe");
+  buffer = frame;
+  Check(fresh.Consume(buffer) && Same(fresh.Processes(), processes),
+        "resync keyframe decodes");
+
+  buffer = string("\x01\0\0\0\x07", 5);
+  Check(!fresh.Consume(buffer), "unknown frame type rejected");
+
+  if (failures == 0) {
+    std::printf("protocol_test: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
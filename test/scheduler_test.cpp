@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "scheduler.h"
+
+using std::vector;
+
+namespace {
+int failures{0};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+constexpr int kRunnable{100000};
+} // namespace
+
+// The fair scheduler with 100k tasks runnable at once
+int main() {
+  Scheduler::Options options;
+  vector<Scheduler::Job> jobs;
+  for (int pid = 1; pid <= kRunnable; ++pid) {
+    jobs.push_back(Scheduler::Job{pid, 0, 20, pid % 2 == 0 ? 0 : 5});
+  }
+
+  // Every task finishes and the CPU never idles
+  Scheduler::VectorSource source(jobs);
+  Scheduler::Result result =
+      Scheduler::Simulate(Scheduler::kFair_, source, options);
+  Check(result.jobs == kRunnable, "every task completes");
+  Check(result.busy == 20L * kRunnable && result.makespan == result.busy,
+        "the CPU is busy until the last task completes");
+
+  // Always runnable, nice 0 gets 1024 / 335 times the CPU of nice 5
+  auto policy = Scheduler::MakePolicy(Scheduler::kFair_, options);
+  vector<Scheduler::Task> tasks;
+  for (Scheduler::Job const &job : jobs) {
+    tasks.push_back(Scheduler::Task{job, job.burst, -1, 0, -1, 0});
+  }
+  for (Scheduler::Task &task : tasks) {
+    policy->Enqueue(&task, 0);
+  }
+  Check(policy->Size() == kRunnable, "100k tasks runnable");
+  long cpu[2] = {0, 0};
+  vector<long> ran(kRunnable + 1, 0);
+  for (long now = 0; now < 40L * kRunnable;) {
+    Scheduler::Task *task = policy->PickNext(now);
+    const long slice = policy->Slice(*task);
+    policy->Ran(*task, slice, true);
+    task->first_run = task->first_run < 0 ? now : task->first_run;
+    now += slice;
+    cpu[task->job.priority == 0 ? 0 : 1] += slice;
+    ran[task->job.pid] += slice;
+    policy->Enqueue(task, now);
+  }
+  // Tasks run whole ticks, so over 20 runs of each nice 5 task the
+  // split is off by up to a run of each nice 0 task in 60
+  const double share = static_cast<double>(cpu[0]) / cpu[1];
+  Check(std::fabs(share / (1024.0 / 335) - 1) < 0.03,
+        "nice 0 gets 3.06 times the CPU of nice 5");
+  // Exactly: CPU time over weight stays within one tick at nice 5
+  long lowest{tasks[0].vruntime}, highest{tasks[0].vruntime};
+  for (Scheduler::Task const &task : tasks) {
+    lowest = std::min(lowest, task.vruntime);
+    highest = std::max(highest, task.vruntime);
+  }
+  Check(highest - lowest <= (1L << Scheduler::kFairShift) * 1024 / 335,
+        "virtual runtimes within one nice 5 tick of each other");
+  bool starved{false};
+  for (int pid = 1; pid <= kRunnable; ++pid) {
+    starved = starved || ran[pid] == 0;
+  }
+  Check(!starved, "no task is starved");
+  std::printf("nice 0 / nice 5 CPU: %.3f\n", share);
+
+  if (failures == 0) {
+    std::printf("scheduler_test: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
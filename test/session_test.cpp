@@ -0,0 +1,144 @@
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "session.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+int failures{0};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+bool Near(double a, double b) { return std::fabs(a - b) < 1e-9; }
+
+// One sample line, every metric but cpu fixed
+string Line(long ms, int pid, double cpu, const char *cgroup,
+            const char *command) {
+  char line[256];
+  std::snprintf(line, sizeof(line), "%ld\t%d\t%.2f\t2048\t0\t1.0\t%s\t%s\n",
+                ms, pid, cpu, cgroup, command);
+  return line;
+}
+
+// Writes a session file of the given lines under a name of its own
+string Write(const char *name, string const &contents) {
+  const string path =
+      "/tmp/session_test_" + std::to_string(getpid()) + "_" + name;
+  FILE *file = std::fopen(path.c_str(), "w");
+  std::fputs(contents.c_str(), file);
+  std::fclose(file);
+  return path;
+}
+
+Session::Delta const *Find(Session::Report const &report,
+                           string const &command) {
+  for (Session::Delta const &delta : report.deltas) {
+    if (delta.command == command) {
+      return &delta;
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+// Diffs two small sessions with known statistics
+int main() {
+  // "web" keeps its spread, "db" doubles its CPU, "cron" exits and
+  // "backup" starts; commands keep their spaces
+  string before = "# ms pid cpu_percent rss_kb io_bytes_per_s "
+                  "switches_per_s cgroup command\n";
+  string after = before;
+  const double web[] = {10, 12, 14, 16};
+  for (int i = 0; i < 4; ++i) {
+    before += Line(i * 1000, 100, web[i], "/web", "nginx -g daemon");
+    after += Line(i * 1000, 200, web[3 - i], "/web", "nginx -g daemon");
+  }
+  for (int i = 0; i < 10; ++i) {
+    before += Line(i * 1000, 300, 10 + i % 2, "/db", "postgres");
+    after += Line(i * 1000, 300, 20 + i % 2, "/db", "postgres");
+  }
+  before += Line(0, 400, 1, "", "cron");
+  after += Line(0, 500, 50, "/backup", "tar czf x");
+  const string before_path = Write("before", before);
+  const string after_path = Write("after", after);
+
+  Session::Reader reader(before_path);
+  Session::Sample sample;
+  Check(reader.Next(sample) && sample.time == 0 && sample.pid == 100 &&
+            Near(sample.values[Session::kCpu_], 10) &&
+            Near(sample.values[Session::kRss_], 2048) &&
+            sample.cgroup == "/web" && sample.command == "nginx -g daemon",
+        "a sample line reads back field by field");
+
+  Session::Report report = Session::Diff(before_path, after_path);
+  Check(report.deltas.size() == 2 && report.added == 1 && report.gone == 1,
+        "two identities matched, one new and one gone");
+  Check(report.before[Session::kCpu_].Count() == 15 &&
+            report.after[Session::kCpu_].Count() == 15,
+        "every sample lands in the histograms");
+  Check(!report.deltas.empty() && report.deltas[0].command == "postgres",
+        "the largest CPU increase comes first");
+
+  Session::Delta const *nginx = Find(report, "nginx -g daemon");
+  Check(nginx != nullptr && nginx->cgroup == "/web",
+        "identities join on command and cgroup across pids");
+  if (nginx != nullptr) {
+    Session::Moments const &cpu = nginx->before[Session::kCpu_];
+    Check(cpu.n == 4 && Near(cpu.mean, 13) && Near(cpu.Variance(), 20.0 / 3) &&
+              Near(cpu.max, 16),
+          "mean, sample variance and max of 10, 12, 14, 16");
+    Check(!nginx->Significant(Session::kCpu_),
+          "the same values in another order are not significant");
+  }
+  Session::Delta const *postgres = Find(report, "postgres");
+  if (postgres != nullptr) {
+    Session::Moments const &cpu = postgres->after[Session::kCpu_];
+    Check(cpu.n == 10 && Near(cpu.mean, 20.5) &&
+              Near(cpu.Variance(), 2.5 / 9),
+          "mean and variance of 20, 21 alternating");
+    Check(postgres->Significant(Session::kCpu_),
+          "a shift of 10 with a spread of 0.5 is significant");
+    Check(!postgres->Significant(Session::kRss_),
+          "an unchanged constant is not significant");
+  }
+
+  // A shift within the noise is not significant, a larger one is
+  for (double shift : {0.1, 2.0}) {
+    Session::Delta delta;
+    for (int i = 0; i < 10; ++i) {
+      delta.before[Session::kCpu_].Add(10 + (i % 2 ? 1 : -1));
+      delta.after[Session::kCpu_].Add(10 + shift + (i % 2 ? 1 : -1));
+    }
+    Check(delta.Significant(Session::kCpu_) == (shift > 1),
+          "the significance flag flips between shifts of 0.1 and 2");
+  }
+
+  const string broken = Write("broken", "0\t1\tx\n");
+  bool thrown{false};
+  try {
+    Session::Reader malformed(broken);
+    malformed.Next(sample);
+  } catch (std::runtime_error const &) {
+    thrown = true;
+  }
+  Check(thrown, "a malformed line throws");
+
+  for (string const &path : {before_path, after_path, broken}) {
+    std::remove(path.c_str());
+  }
+  if (failures == 0) {
+    std::printf("session_test: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
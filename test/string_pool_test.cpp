@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "string_pool.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+int failures{0};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+} // namespace
+
+// Interning into a fresh pool and across chunks
+int main() {
+  StringPool pool;
+  string_view empty = pool.Intern("");
+  Check(empty.empty() && empty.data() != nullptr,
+        "the empty string interns into an empty pool");
+  Check(pool.Intern(string()).data() == empty.data(),
+        "every empty string shares one address");
+
+  string_view bash = pool.Intern("bash");
+  Check(bash == "bash" && pool.Intern(string("bash")).data() == bash.data(),
+        "equal strings share one copy");
+  Check(pool.Intern("bas").data() != bash.data(), "a prefix is its own string");
+
+  // Fill past a chunk, earlier views stay valid
+  for (int i = 0; i < 20000; ++i) {
+    pool.Intern("command " + std::to_string(i));
+  }
+  const string big(40000, 'x');
+  Check(pool.Intern(big) == big, "an oversized string gets a chunk");
+  Check(bash == "bash" && pool.Intern("bash").data() == bash.data(),
+        "views survive new chunks");
+
+  if (failures == 0) {
+    std::printf("string_pool_test: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
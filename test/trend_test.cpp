@@ -0,0 +1,65 @@
+#include <cmath>
+#include <cstdio>
+
+#include "trend.h"
+
+namespace {
+int failures{0};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+bool Near(double a, double b, double tolerance) {
+  return std::fabs(a - b) < tolerance;
+}
+} // namespace
+
+// Slopes of synthetic series
+int main() {
+  Trend trend;
+  Check(trend.Slope() == 0.0 && trend.Count() == 0, "empty trend is flat");
+  trend.Add(5.0, 100.0);
+  Check(trend.Slope() == 0.0 && trend.LastTime() == 5.0,
+        "one sample is flat");
+  trend.Add(7.0, 104.0);
+  Check(Near(trend.Slope(), 2.0, 1e-9), "two samples give their slope");
+
+  // The ring keeps the last 32 samples, an older trend leaves the window
+  Trend ring;
+  for (int t = 0; t < 100; ++t) {
+    ring.Add(t, t < 50 ? 3.0 * t : 150.0 - t);
+  }
+  Check(ring.Count() == 32, "the ring holds 32 samples");
+  Check(Near(ring.Slope(), -1.0, 1e-6), "only the recent slope remains");
+  Check(ring.LastTime() == 99.0, "the last time survives the ring");
+
+  // Noise around a line averages out
+  Trend noisy;
+  for (int t = 0; t < 32; ++t) {
+    noisy.Add(t, 10.0 + 0.5 * t + (t % 2 ? 1.0 : -1.0));
+  }
+  Check(Near(noisy.Slope(), 0.5, 0.01), "least squares through noise");
+
+  // A year of samples every 10 minutes, then a leak of 4 MB/min sampled
+  // every 1.5 s; offsets from the first sample only resolve 2 s by then
+  Trend year;
+  const double start = 365 * 24 * 3600.0;
+  for (double t = 0.0; t < start; t += 600.0) {
+    year.Add(t, 1000.0);
+  }
+  for (int i = 0; i < 32; ++i) {
+    const double t = start + 1.5 * i;
+    year.Add(t, 1000.0 + 4.0 * (t - start) / 60);
+  }
+  Check(Near(year.Slope() * 60, 4.0, 1e-3), "slope after a year");
+  Check(year.LastTime() == start + 1.5 * 31, "last time after a year");
+
+  if (failures == 0) {
+    std::printf("trend_test: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}